@@ -0,0 +1,119 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Micro-benchmark: find_client() lookup cost against number of clients.
+//
+// Builds the same window+parent index the window manager uses and times
+// lookups for client counts from 10 to 10,000, alongside the old approach of
+// scanning a linked list.  Output is one line per client count, fields
+// separated by spaces as name=value:
+//
+//   find_client clients=N hash_ns=T list_ns=T
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "hash.h"
+#include "list.h"
+
+struct fake_client {
+	unsigned long window;
+	unsigned long parent;
+};
+
+#define LOOKUPS 2000000
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// X resource IDs: application windows come from several X clients' ID
+// ranges, frames all come from the window manager's range.
+
+static void make_clients(struct fake_client *c, unsigned n) {
+	for (unsigned i = 0; i < n; i++) {
+		c[i].window = ((unsigned long)(2 + i % 37) << 21) + 0x10 + i;
+		c[i].parent = (1UL << 21) + 0x100 + i;
+	}
+}
+
+static struct fake_client *list_lookup(struct list *list, unsigned long w) {
+	for (struct list *iter = list; iter; iter = iter->next) {
+		struct fake_client *c = iter->data;
+		if (w == c->parent || w == c->window)
+			return c;
+	}
+	return NULL;
+}
+
+int main(int argc, char **argv) {
+	static const unsigned counts[] = { 10, 100, 300, 1000, 3000, 10000 };
+	int do_list = !(argc > 1 && argv[1][0] == '-' && argv[1][1] == 'q');
+	unsigned long misses = 0;
+
+	for (unsigned ci = 0; ci < sizeof(counts)/sizeof(counts[0]); ci++) {
+		unsigned n = counts[ci];
+		struct fake_client *clients = calloc(n, sizeof(*clients));
+		unsigned long *keys = calloc(LOOKUPS, sizeof(*keys));
+		struct hash index = { 0 };
+		struct list *list = NULL;
+		if (!clients || !keys)
+			return 1;
+
+		make_clients(clients, n);
+		for (unsigned i = 0; i < n; i++) {
+			hash_insert(&index, clients[i].window, &clients[i]);
+			hash_insert(&index, clients[i].parent, &clients[i]);
+			list = list_prepend(list, &clients[i]);
+		}
+
+		// Mix of frame and window lookups across all clients, plus a
+		// few unknown windows (as for events on unmanaged windows).
+		srand(n);
+		for (unsigned i = 0; i < LOOKUPS; i++) {
+			struct fake_client *c = &clients[rand() % n];
+			switch (i % 8) {
+			case 0: keys[i] = 0x7f000000UL + i; break;
+			case 1: case 2: case 3: keys[i] = c->window; break;
+			default: keys[i] = c->parent; break;
+			}
+		}
+
+		double t0 = now_ns();
+		for (unsigned i = 0; i < LOOKUPS; i++) {
+			if (!hash_find(&index, keys[i]))
+				misses++;
+		}
+		double hash_ns = (now_ns() - t0) / LOOKUPS;
+
+		double list_ns = 0.0;
+		if (do_list) {
+			// Linear scans get slow; scale iterations down.
+			unsigned lookups = LOOKUPS / (n / 10);
+			t0 = now_ns();
+			for (unsigned i = 0; i < lookups; i++) {
+				if (!list_lookup(list, keys[i]))
+					misses++;
+			}
+			list_ns = (now_ns() - t0) / lookups;
+		}
+
+		printf("find_client clients=%u hash_ns=%.1f list_ns=%.1f\n", n, hash_ns, list_ns);
+
+		while (list)
+			list = list_delete(list, list->data);
+		hash_clear(&index);
+		free(keys);
+		free(clients);
+	}
+	// Stop the compiler optimising lookups away
+	return misses == 0;
+}
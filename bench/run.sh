@@ -0,0 +1,55 @@
+#!/bin/sh
+# evilwm - minimalist window manager for X11
+# Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+# see README for license and other details.
+
+# Run evilwm under a private Xvfb server and time its responses with wmbench.
+#
+# usage: run.sh EVILWM WMBENCH [WMBENCH-ARGS...]
+#
+# Skipped (with success) if Xvfb isn't installed.  Set XVFB to use a
+# different server binary, XVFB_SCREENS for a multi-screen (Zaphod) display,
+# and EVILWM_ARGS to pass extra options to evilwm.
+
+XVFB=${XVFB:-Xvfb}
+XVFB_SCREENS=${XVFB_SCREENS:-1}
+EVILWM=$1
+WMBENCH=$2
+shift 2
+
+if ! command -v "$XVFB" >/dev/null 2>&1; then
+	echo "wmbench: $XVFB not found, skipping" >&2
+	exit 0
+fi
+
+# Find a free display number
+d=90
+while [ -e "/tmp/.X$d-lock" ] || [ -e "/tmp/.X11-unix/X$d" ]; do
+	d=$((d + 1))
+done
+
+screens=
+s=0
+while [ $s -lt "$XVFB_SCREENS" ]; do
+	screens="$screens -screen $s 1280x1024x24"
+	s=$((s + 1))
+done
+
+"$XVFB" ":$d" $screens -nolisten tcp >/dev/null 2>&1 &
+xvfb_pid=$!
+trap 'kill $wm_pid $xvfb_pid 2>/dev/null' EXIT INT TERM
+
+i=0
+while [ ! -e "/tmp/.X11-unix/X$d" ]; do
+	i=$((i + 1))
+	if [ $i -gt 50 ] || ! kill -0 $xvfb_pid 2>/dev/null; then
+		echo "wmbench: $XVFB failed to start" >&2
+		exit 1
+	fi
+	sleep 0.1
+done
+
+DISPLAY=":$d" "$EVILWM" --snap 0 --soliddrag 1 $EVILWM_ARGS &
+wm_pid=$!
+
+DISPLAY=":$d" "$WMBENCH" "$@"
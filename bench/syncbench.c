@@ -0,0 +1,257 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Benchmark: solid resizes against a slow client, with and without
+// _NET_WM_SYNC_REQUEST.
+//
+// Maps one window that plays the part of a slow client: handling each
+// resize takes it a fixed time (-d MS), during which further configures
+// just pile up.  With -s, it lists _NET_WM_SYNC_REQUEST in WM_PROTOCOLS and
+// updates its counter each time it catches up.  A resize (mask2+button2) is
+// then driven through the XTest extension with pointer motion at a fixed
+// rate (-r per second) for a number of steps (-n).  Intended to be run
+// against a throwaway X server by bench/run.sh, with --solidsweep 1.
+// Output is one line, fields separated by spaces as name=value:
+//
+//   syncbench sync=S motions=N configures=N coalesced=N backlog=N
+//             backlog_max=N requests=N acked=N
+//
+// configures counts resizes the client saw, and coalesced is motions less
+// configures.  backlog counts resizes that arrived while the client was
+// still busy with an earlier one, and backlog_max the most at any one time.
+// requests counts _NET_WM_SYNC_REQUEST messages, and acked how many of those
+// the client acknowledged.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#include <X11/X.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+
+#ifdef XTEST
+#include <X11/extensions/XTest.h>
+#include <X11/extensions/sync.h>
+#endif
+
+#ifdef XTEST
+
+// Time to let things settle after the last motion
+#define DRAIN_US 500000.
+
+static Display *dpy;
+static Window root;
+
+static double now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int wait_for_wm(void) {
+	Atom a_check = XInternAtom(dpy, "_NET_SUPPORTING_WM_CHECK", False);
+	double deadline = now_us() + 10e6;
+	while (now_us() < deadline) {
+		Atom type;
+		int format;
+		unsigned long nitems, after;
+		unsigned char *data = NULL;
+		if (XGetWindowProperty(dpy, root, a_check, 0, 1, False, XA_WINDOW,
+		                       &type, &format, &nitems, &after, &data) == Success) {
+			if (data)
+				XFree(data);
+			if (type == XA_WINDOW && nitems == 1)
+				return 1;
+		}
+		nanosleep(&(struct timespec){ .tv_nsec = 10000000 }, NULL);
+	}
+	return 0;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: syncbench [-s] [-n MOTIONS] [-r MOTIONS_PER_SEC] [-d DELAY_MS]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	int use_sync = 0;
+	unsigned n = 500;
+	double rate = 250., delay_us = 20000.;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "sn:r:d:")) != -1) {
+		switch (opt) {
+		case 's': use_sync = 1; break;
+		case 'n': n = strtoul(optarg, NULL, 0); break;
+		case 'r': rate = strtod(optarg, NULL); break;
+		case 'd': delay_us = strtod(optarg, NULL) * 1e3; break;
+		default: usage();
+		}
+	}
+	if (n < 1 || rate <= 0.)
+		usage();
+
+	if (!(dpy = XOpenDisplay(NULL))) {
+		fprintf(stderr, "syncbench: can't open display\n");
+		return 1;
+	}
+	root = DefaultRootWindow(dpy);
+	int sync_event, sync_error, major, minor;
+	if (!XSyncQueryExtension(dpy, &sync_event, &sync_error)
+	    || !XSyncInitialize(dpy, &major, &minor)) {
+		fprintf(stderr, "syncbench: no SYNC extension, skipping\n");
+		return 0;
+	}
+	if (!wait_for_wm()) {
+		fprintf(stderr, "syncbench: no window manager running\n");
+		return 1;
+	}
+
+	Atom a_wm_protocols = XInternAtom(dpy, "WM_PROTOCOLS", False);
+	Atom a_sync_request = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST", False);
+	Atom a_sync_counter = XInternAtom(dpy, "_NET_WM_SYNC_REQUEST_COUNTER", False);
+
+	Window w = XCreateSimpleWindow(dpy, root, 100, 100, 300, 200, 1,
+	                               BlackPixel(dpy, 0), WhitePixel(dpy, 0));
+	XSelectInput(dpy, w, StructureNotifyMask);
+	XStoreName(dpy, w, "syncbench");
+	XSyncValue zero;
+	XSyncIntToValue(&zero, 0);
+	XSyncCounter counter = XSyncCreateCounter(dpy, zero);
+	if (use_sync) {
+		unsigned long c = counter;
+		XSetWMProtocols(dpy, w, &a_sync_request, 1);
+		XChangeProperty(dpy, w, a_sync_counter, XA_CARDINAL, 32, PropModeReplace,
+		                (unsigned char *)&c, 1);
+	}
+	XMapWindow(dpy, w);
+	for (;;) {
+		XEvent ev;
+		XNextEvent(dpy, &ev);
+		if (ev.type == MapNotify && ev.xmap.window == w)
+			break;
+	}
+	XSync(dpy, False);
+	nanosleep(&(struct timespec){ .tv_nsec = 100000000 }, NULL);
+
+	KeyCode alt = XKeysymToKeycode(dpy, XK_Alt_L);
+	Window child;
+	int x0, y0;
+	XTranslateCoordinates(dpy, w, root, 280, 180, &x0, &y0, &child);
+	XTestFakeMotionEvent(dpy, -1, x0, y0, CurrentTime);
+	XTestFakeKeyEvent(dpy, alt, True, CurrentTime);
+	XTestFakeButtonEvent(dpy, 2, True, CurrentTime);
+	XSync(dpy, False);
+
+	unsigned motions = 0, configures = 0, backlog = 0, backlog_max = 0;
+	unsigned requests = 0, acked = 0, queued = 0;
+	int width = 300, height = 200;
+	int busy = 0, have_request = 0;
+	XSyncValue request_value;
+	double interval = 1e6 / rate;
+	double next_motion = now_us(), busy_until = 0., end = 0.;
+
+	for (;;) {
+		double now = now_us();
+		if (motions < n && now >= next_motion) {
+			// Sawtooth, so the window stays a sensible size
+			int step = motions % 100;
+			XTestFakeMotionEvent(dpy, -1, x0 + step * 2, y0 + step, CurrentTime);
+			motions++;
+			next_motion += interval;
+			if (motions == n)
+				end = now + DRAIN_US;
+		}
+		if (busy && now >= busy_until) {
+			// Caught up: repaint once more for anything that
+			// arrived meanwhile, else acknowledge
+			if (queued) {
+				queued = 0;
+				busy_until = now + delay_us;
+			} else {
+				busy = 0;
+				if (have_request) {
+					XSyncSetCounter(dpy, counter, request_value);
+					have_request = 0;
+					acked++;
+				}
+			}
+		}
+		if (motions == n && now >= end && !busy)
+			break;
+		XFlush(dpy);
+
+		while (XPending(dpy)) {
+			XEvent ev;
+			XNextEvent(dpy, &ev);
+			if (ev.type == ClientMessage && ev.xclient.window == w
+			    && ev.xclient.message_type == a_wm_protocols
+			    && (Atom)ev.xclient.data.l[0] == a_sync_request) {
+				XSyncIntsToValue(&request_value, ev.xclient.data.l[2],
+				                 ev.xclient.data.l[3]);
+				have_request = 1;
+				requests++;
+			} else if (ev.type == ConfigureNotify && ev.xconfigure.window == w
+			           && !ev.xconfigure.send_event
+			           && (ev.xconfigure.width != width
+			               || ev.xconfigure.height != height)) {
+				width = ev.xconfigure.width;
+				height = ev.xconfigure.height;
+				configures++;
+				if (busy) {
+					backlog++;
+					if (++queued > backlog_max)
+						backlog_max = queued;
+				} else {
+					busy = 1;
+					busy_until = now_us() + delay_us;
+				}
+			}
+		}
+
+		double wake = motions < n ? next_motion : end;
+		if (busy && busy_until < wake)
+			wake = busy_until;
+		double left = wake - now_us();
+		if (left > 0.) {
+			int fd = ConnectionNumber(dpy);
+			fd_set fds;
+			FD_ZERO(&fds);
+			FD_SET(fd, &fds);
+			struct timeval tv = { .tv_sec = left / 1e6, .tv_usec = (long)left % 1000000 };
+			select(fd + 1, &fds, NULL, NULL, &tv);
+		}
+	}
+
+	XTestFakeButtonEvent(dpy, 2, False, CurrentTime);
+	XTestFakeKeyEvent(dpy, alt, False, CurrentTime);
+	XSync(dpy, False);
+
+	printf("syncbench sync=%d motions=%u configures=%u coalesced=%u backlog=%u"
+	       " backlog_max=%u requests=%u acked=%u\n", use_sync, motions, configures,
+	       motions - configures, backlog, backlog_max, requests, acked);
+
+	XSyncDestroyCounter(dpy, counter);
+	XCloseDisplay(dpy);
+	return 0;
+}
+
+#else
+
+int main(void) {
+	fprintf(stderr, "syncbench: built without XTEST, skipping\n");
+	return 0;
+}
+
+#endif
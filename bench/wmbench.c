@@ -0,0 +1,462 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Benchmark: window manager response latency, as seen by an X client.
+//
+// Creates N windows, then maps, renames, configures, restacks, focusses,
+// drags and destroys them, timing how long the window manager takes to act
+// on each request.  Intended to be run against a throwaway X server by
+// bench/run.sh.  Output is one line per operation, fields separated by
+// spaces as name=value:
+//
+//   wmbench op=NAME n=N timeouts=N mean_us=T p50_us=T p95_us=T max_us=T
+//
+// Operations, and the event that marks completion:
+//
+//   map        XMapWindow() until MapNotify on the window
+//   configure  rename and XResizeWindow() until ConfigureNotify on the window
+//   restack    XRaiseWindow() until ConfigureNotify on the frame
+//   raiseall   XRaiseWindow() on every window in turn, without waiting, until
+//              ConfigureNotify on the frame of the last one (which started
+//              at the bottom)
+//   focus      _NET_ACTIVE_WINDOW message until FocusIn on the window
+//   vdesk      _NET_CURRENT_DESKTOP message until the root property changes
+//   drag       pointer motion with button held until the frame moves
+//   destroy    XDestroyWindow() until _NET_CLIENT_LIST changes
+//
+// Drags are driven through the XTest extension, so are only measured if
+// built with -DXTEST.
+//
+// With -b N, N background windows are first mapped on each screen other
+// than the default, so that on a multi-screen display the cost of clients
+// elsewhere shows up in the timings.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#include <X11/X.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/keysym.h>
+
+#ifdef XTEST
+#include <X11/extensions/XTest.h>
+#endif
+
+// How long to wait for the window manager before giving up on an operation
+#define TIMEOUT_US 2000000.
+
+// Number of times to raise every window for the raiseall operation
+#define RAISEALL_ROUNDS 10
+
+struct op {
+	const char *name;
+	unsigned n;
+	unsigned timeouts;
+	double *samples;
+};
+
+struct win {
+	Window w;
+	Window frame;
+};
+
+static Display *dpy;
+static Window root;
+static double interval_us;  // minimum time between operations, from -r
+static double next_op_us;
+
+static Atom a_net_active_window;
+static Atom a_net_client_list;
+static Atom a_net_current_desktop;
+static Atom a_net_supporting_wm_check;
+
+static double now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Start an operation.  Holds off to achieve the requested rate, then
+// discards any events left over from earlier operations so that they aren't
+// mistaken for a response.  Returns start time.
+
+static double begin_op(void) {
+	if (interval_us > 0.) {
+		double now = now_us();
+		if (next_op_us > now) {
+			double wait = next_op_us - now;
+			struct timespec ts = { .tv_sec = wait / 1e6, .tv_nsec = ((long)wait % 1000000) * 1000 };
+			nanosleep(&ts, NULL);
+		} else {
+			next_op_us = now;
+		}
+		next_op_us += interval_us;
+	}
+	XSync(dpy, False);
+	while (XPending(dpy)) {
+		XEvent ev;
+		XNextEvent(dpy, &ev);
+	}
+	return now_us();
+}
+
+// Wait for an event satisfying match().  Anything else is discarded.
+// Returns 1 if found before timeout.
+
+typedef int (*match_func)(XEvent *ev, const void *arg);
+
+static int wait_for(match_func match, const void *arg) {
+	double deadline = now_us() + TIMEOUT_US;
+	XFlush(dpy);
+	for (;;) {
+		while (XPending(dpy)) {
+			XEvent ev;
+			XNextEvent(dpy, &ev);
+			if (match(&ev, arg))
+				return 1;
+		}
+		double left = deadline - now_us();
+		if (left <= 0.)
+			return 0;
+		int fd = ConnectionNumber(dpy);
+		fd_set fds;
+		FD_ZERO(&fds);
+		FD_SET(fd, &fds);
+		struct timeval tv = { .tv_sec = left / 1e6, .tv_usec = (long)left % 1000000 };
+		select(fd + 1, &fds, NULL, NULL, &tv);
+	}
+}
+
+static void record(struct op *op, double start, int ok) {
+	if (!ok) {
+		op->timeouts++;
+		return;
+	}
+	op->samples[op->n++] = now_us() - start;
+}
+
+static int cmp_double(const void *a, const void *b) {
+	double da = *(const double *)a, db = *(const double *)b;
+	return (da > db) - (da < db);
+}
+
+static void report(struct op *op) {
+	double sum = 0.;
+	printf("wmbench op=%s n=%u timeouts=%u", op->name, op->n, op->timeouts);
+	if (op->n == 0) {
+		printf("\n");
+		return;
+	}
+	qsort(op->samples, op->n, sizeof(double), cmp_double);
+	for (unsigned i = 0; i < op->n; i++)
+		sum += op->samples[i];
+	printf(" mean_us=%.1f p50_us=%.1f p95_us=%.1f max_us=%.1f\n",
+	       sum / op->n, op->samples[op->n / 2],
+	       op->samples[(op->n * 95) / 100], op->samples[op->n - 1]);
+	fflush(stdout);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+// Event matchers
+
+static int match_map(XEvent *ev, const void *arg) {
+	return ev->type == MapNotify && ev->xmap.window == *(const Window *)arg;
+}
+
+static int match_configure(XEvent *ev, const void *arg) {
+	const XWindowChanges *wc = arg;
+	return ev->type == ConfigureNotify && !ev->xconfigure.send_event
+	       && ev->xconfigure.window == wc->sibling
+	       && ev->xconfigure.width == wc->width
+	       && ev->xconfigure.height == wc->height;
+}
+
+static int match_frame_configure(XEvent *ev, const void *arg) {
+	return ev->type == ConfigureNotify && !ev->xconfigure.send_event
+	       && ev->xconfigure.window == *(const Window *)arg;
+}
+
+static int match_focus(XEvent *ev, const void *arg) {
+	return ev->type == FocusIn && ev->xfocus.window == *(const Window *)arg;
+}
+
+static int match_root_property(XEvent *ev, const void *arg) {
+	return ev->type == PropertyNotify && ev->xproperty.window == root
+	       && ev->xproperty.atom == *(const Atom *)arg;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+static void send_root_message(Window w, Atom type, long l0, long l1) {
+	XEvent ev = { .xclient = {
+		.type = ClientMessage,
+		.window = w,
+		.message_type = type,
+		.format = 32,
+		.data.l = { l0, l1, 0, 0, 0 },
+	} };
+	XSendEvent(dpy, root, False, SubstructureNotifyMask | SubstructureRedirectMask, &ev);
+}
+
+static int wait_for_wm(void) {
+	double deadline = now_us() + 5 * TIMEOUT_US;
+	while (now_us() < deadline) {
+		Atom type;
+		int format;
+		unsigned long nitems, after;
+		unsigned char *data = NULL;
+		if (XGetWindowProperty(dpy, root, a_net_supporting_wm_check, 0, 1, False,
+		                       XA_WINDOW, &type, &format, &nitems, &after, &data) == Success) {
+			if (data)
+				XFree(data);
+			if (type == XA_WINDOW && nitems == 1)
+				return 1;
+		}
+		nanosleep(&(struct timespec){ .tv_nsec = 10000000 }, NULL);
+	}
+	return 0;
+}
+
+static Window find_frame(Window w) {
+	Window r, parent, *children;
+	unsigned nchildren;
+	if (!XQueryTree(dpy, w, &r, &parent, &children, &nchildren))
+		return None;
+	if (children)
+		XFree(children);
+	return (parent == root) ? None : parent;
+}
+
+// Wait for a newly mapped window to become visible.  The window manager
+// reparents (and so maps) the window itself well before it maps the frame,
+// so it's the frame's MapNotify that counts.  That may already have happened
+// by the time the frame is known, so check its state once selected for.
+
+static int wait_visible(struct win *win) {
+	XWindowAttributes attr;
+	if (!wait_for(match_map, &win->w))
+		return 0;
+	win->frame = find_frame(win->w);
+	if (!win->frame)
+		return 1;
+	XSelectInput(dpy, win->frame, StructureNotifyMask);
+	if (XGetWindowAttributes(dpy, win->frame, &attr) && attr.map_state == IsViewable)
+		return 1;
+	return wait_for(match_map, &win->frame);
+}
+
+#ifdef XTEST
+
+static void bench_drag(struct op *op, struct win *win, unsigned n) {
+	Window child;
+	int x, y;
+	KeyCode alt = XKeysymToKeycode(dpy, XK_Alt_L);
+	if (!win->frame || !alt)
+		return;
+	XTranslateCoordinates(dpy, win->w, root, 10, 10, &x, &y, &child);
+	XTestFakeMotionEvent(dpy, -1, x, y, CurrentTime);
+	XTestFakeKeyEvent(dpy, alt, True, CurrentTime);
+	XTestFakeButtonEvent(dpy, 1, True, CurrentTime);
+	XSync(dpy, False);
+	for (unsigned i = 0; i < n; i++) {
+		double start = begin_op();
+		x += (i & 1) ? -3 : 4;
+		y += (i & 2) ? -3 : 4;
+		XTestFakeMotionEvent(dpy, -1, x, y, CurrentTime);
+		record(op, start, wait_for(match_frame_configure, &win->frame));
+	}
+	XTestFakeButtonEvent(dpy, 1, False, CurrentTime);
+	XTestFakeKeyEvent(dpy, alt, False, CurrentTime);
+	XSync(dpy, False);
+}
+
+#endif
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+// Map n windows on every screen but the default, waiting for each.  Returns
+// how many were mapped.
+
+static unsigned map_background(unsigned n) {
+	unsigned mapped = 0;
+	for (int s = 0; s < ScreenCount(dpy); s++) {
+		if (s == DefaultScreen(dpy))
+			continue;
+		for (unsigned i = 0; i < n; i++) {
+			Window w = XCreateSimpleWindow(dpy, RootWindow(dpy, s),
+			                               20 + (i % 20) * 10, 20 + (i % 17) * 10,
+			                               200, 150, 1, BlackPixel(dpy, s), WhitePixel(dpy, s));
+			XSelectInput(dpy, w, StructureNotifyMask);
+			XStoreName(dpy, w, "wmbench background");
+			XMapWindow(dpy, w);
+			if (wait_for(match_map, &w))
+				mapped++;
+		}
+	}
+	return mapped;
+}
+
+static void usage(void) {
+	fprintf(stderr, "usage: wmbench [-n WINDOWS] [-r OPS_PER_SEC] [-b BACKGROUND_WINDOWS]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv) {
+	unsigned n = 50, nbackground = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:r:b:")) != -1) {
+		switch (opt) {
+		case 'n': n = strtoul(optarg, NULL, 0); break;
+		case 'b': nbackground = strtoul(optarg, NULL, 0); break;
+		case 'r': {
+			double rate = strtod(optarg, NULL);
+			interval_us = (rate > 0.) ? 1e6 / rate : 0.;
+			break;
+		}
+		default: usage();
+		}
+	}
+	if (n < 2)
+		usage();
+
+	if (!(dpy = XOpenDisplay(NULL))) {
+		fprintf(stderr, "wmbench: can't open display\n");
+		return 1;
+	}
+	root = DefaultRootWindow(dpy);
+	a_net_active_window = XInternAtom(dpy, "_NET_ACTIVE_WINDOW", False);
+	a_net_client_list = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+	a_net_current_desktop = XInternAtom(dpy, "_NET_CURRENT_DESKTOP", False);
+	a_net_supporting_wm_check = XInternAtom(dpy, "_NET_SUPPORTING_WM_CHECK", False);
+
+	if (!wait_for_wm()) {
+		fprintf(stderr, "wmbench: no window manager running\n");
+		return 1;
+	}
+	if (nbackground) {
+		unsigned mapped = map_background(nbackground);
+		printf("wmbench screens=%d background=%u\n", ScreenCount(dpy), mapped);
+	}
+	XSelectInput(dpy, root, PropertyChangeMask);
+
+	struct op map = { .name = "map" };
+	struct op configure = { .name = "configure" };
+	struct op restack = { .name = "restack" };
+	struct op raiseall = { .name = "raiseall" };
+	struct op focus = { .name = "focus" };
+	struct op vdesk = { .name = "vdesk" };
+	struct op drag = { .name = "drag" };
+	struct op destroy = { .name = "destroy" };
+	struct op *ops[] = { &map, &configure, &restack, &raiseall, &focus, &vdesk, &drag, &destroy };
+	for (unsigned i = 0; i < sizeof(ops) / sizeof(ops[0]); i++)
+		ops[i]->samples = calloc(n > RAISEALL_ROUNDS ? n : RAISEALL_ROUNDS, sizeof(double));
+	struct win *wins = calloc(n, sizeof(*wins));
+	if (!wins)
+		return 1;
+
+	// Map
+	for (unsigned i = 0; i < n; i++) {
+		char name[32];
+		Window w = XCreateSimpleWindow(dpy, root, 20 + (i % 20) * 10, 20 + (i % 17) * 10,
+		                               200, 150, 1, BlackPixel(dpy, 0), WhitePixel(dpy, 0));
+		XSelectInput(dpy, w, StructureNotifyMask | FocusChangeMask);
+		snprintf(name, sizeof(name), "wmbench %u", i);
+		XStoreName(dpy, w, name);
+		wins[i].w = w;
+		double start = begin_op();
+		XMapWindow(dpy, w);
+		record(&map, start, wait_visible(&wins[i]));
+	}
+
+	// Rename & configure.  The rename's PropertyNotify is queued for the
+	// window manager ahead of the configure request.
+	for (unsigned i = 0; i < n; i++) {
+		char name[32];
+		XWindowChanges wc = { .sibling = wins[i].w, .width = 210 + (i & 7), .height = 160 + (i & 3) };
+		snprintf(name, sizeof(name), "wmbench %u renamed", i);
+		double start = begin_op();
+		XStoreName(dpy, wins[i].w, name);
+		XResizeWindow(dpy, wins[i].w, wc.width, wc.height);
+		record(&configure, start, wait_for(match_configure, &wc));
+	}
+
+	// Restack: raising each window from the oldest always changes order
+	for (unsigned i = 0; i < n; i++) {
+		if (!wins[i].frame)
+			continue;
+		double start = begin_op();
+		XRaiseWindow(dpy, wins[i].w);
+		record(&restack, start, wait_for(match_frame_configure, &wins[i].frame));
+	}
+
+	// Raise all: the restack pass left them stacked oldest at the bottom,
+	// so raising newest to oldest ends with the oldest on top, and each
+	// round reverses the order for the next
+	for (unsigned r = 0; r < RAISEALL_ROUNDS; r++) {
+		Window *last = NULL;
+		double start = begin_op();
+		for (unsigned j = 0; j < n; j++) {
+			struct win *win = &wins[(r & 1) ? j : n - 1 - j];
+			if (!win->frame)
+				continue;
+			XRaiseWindow(dpy, win->w);
+			last = &win->frame;
+		}
+		if (!last)
+			break;
+		record(&raiseall, start, wait_for(match_frame_configure, last));
+	}
+
+	// Focus: start from the last window so that each request is a change
+	send_root_message(wins[n-1].w, a_net_active_window, 2, CurrentTime);
+	wait_for(match_focus, &wins[n-1].w);
+	for (unsigned i = 0; i + 1 < n; i++) {
+		double start = begin_op();
+		send_root_message(wins[i].w, a_net_active_window, 2, CurrentTime);
+		record(&focus, start, wait_for(match_focus, &wins[i].w));
+	}
+
+	// Virtual desktop switch, alternating between two, and ending up
+	// back where we started
+	for (unsigned i = 0; i < (n & ~1U); i++) {
+		double start = begin_op();
+		send_root_message(root, a_net_current_desktop, (i & 1) ? 0 : 1, CurrentTime);
+		record(&vdesk, start, wait_for(match_root_property, &a_net_current_desktop));
+	}
+
+#ifdef XTEST
+	// Drag the most recently raised window around
+	bench_drag(&drag, &wins[n-1], n);
+#endif
+
+	// Destroy
+	for (unsigned i = 0; i < n; i++) {
+		double start = begin_op();
+		XDestroyWindow(dpy, wins[i].w);
+		record(&destroy, start, wait_for(match_root_property, &a_net_client_list));
+	}
+
+	for (unsigned i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+#ifndef XTEST
+		if (ops[i] == &drag)
+			continue;
+#endif
+		report(ops[i]);
+	}
+
+	XCloseDisplay(dpy);
+	return 0;
+}
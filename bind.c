@@ -26,6 +26,7 @@
 #include "display.h"
 #include "evilwm.h"
 #include "func.h"
+#include "hash.h"
 #include "list.h"
 #include "log.h"
 #include "screen.h"
@@ -212,6 +213,19 @@ struct bind {
 
 static struct list *controls = NULL;
 
+// Dispatch table mapping an event's keycode or button and cleaned modifier
+// state directly to the bind it triggers.  Rebuilt from 'controls' whenever
+// grabs are reapplied, as keycodes only mean anything for a particular
+// keyboard mapping.
+static struct hash dispatch;
+static void bind_rebuild_dispatch(void);
+
+static unsigned long dispatch_key(int type, unsigned code, unsigned state) {
+	// Keycodes are 8 bits; buttons get the same space
+	return ((unsigned long)(state & KEY_STATE_MASK & ~numlockmask) << 9)
+	       | ((code & 0xff) << 1) | (type == ButtonPress);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 // String-to-value mapping helper functions
@@ -267,12 +281,6 @@ void stashbinds(struct screen *s) {
 		} else if (b->type == ButtonPress) {
 			LOG_DEBUG(":");
 			buttoncontrols = list_prepend(buttoncontrols, b);
-			//ungrab buttons on all clients
-			for (struct list *lc = clients_tab_order; lc; lc = lc->next) {
-				struct client *c = lc->data;
-				if (c->screen != s) continue;
-				XUngrabButton(display.dpy, b->control.button, b->state, c->parent);
-			}
 		} else {
 			LOG_DEBUG(".");
 		}
@@ -288,12 +296,15 @@ void stashbinds(struct screen *s) {
 		};
 		controls = list_prepend(controls, b);
 	}
-	//rebind kept controls
+	//rebind kept controls, ungrabbing buttons on all clients
 	bind_grab_for_screen(s);
+	for (struct client *c = s->mapping.head; c; c = c->mapping.next)
+		bind_grab_for_client(c);
 	//and add button controls back to the list, for border clicks
 	struct list *l = controls;
 	while (l->next) l=l->next;
 	l->next = buttoncontrols;
+	bind_rebuild_dispatch();
 }
 void unstashbinds(struct screen *s) {
 	if (!controlstash) return;
@@ -303,11 +314,8 @@ void unstashbinds(struct screen *s) {
 	controlstash = NULL;
 	bind_grab_for_screen(s);
 	// go through and grab buttons on clients
-	for (struct list *l = clients_tab_order; l; l = l->next) {
-		struct client *c = l->data;
-		if (c->screen != s) continue;
+	for (struct client *c = s->mapping.head; c; c = c->mapping.next)
 		bind_grab_for_client(c);
-	}
 }
 void togglebinds(struct screen *s) {
 	if (controlstash) unstashbinds(s);
@@ -317,6 +325,7 @@ void togglebinds(struct screen *s) {
 void bind_unset(void) {
 	// unbind _all_ controls
 	// note, does not ungrab keysyms & buttons
+	hash_clear(&dispatch);
 	while (controls) {
 		struct bind *b = controls->data;
 		controls = list_delete(controls, b);
@@ -405,7 +414,9 @@ void bind_control(const char *ctlname, const char *func) {
 	if (newbind->type == ButtonPress && !newbind->state)
 		newbind->state = grabmask2;
 
-	// always unbind any existing matching control
+	// always unbind any existing matching control.  dispatch table is
+	// rebuilt when grabs are next applied.
+	hash_clear(&dispatch);
 	for (struct list *l = controls; l; l = l->next) {
 		struct bind *b = l->data;
 		if (b->state != newbind->state) continue;
@@ -470,61 +481,177 @@ void bind_control(const char *ctlname, const char *func) {
 	free(funcdup);
 }
 
-static void grab_keysym(KeySym keysym, unsigned modmask, Window w) {
-	KeyCode keycode = XKeysymToKeycode(display.dpy, keysym);
-	XGrabKey(display.dpy, keycode, modmask, w, True,
-		 GrabModeAsync, GrabModeAsync);
-	XGrabKey(display.dpy, keycode, modmask|LockMask, w, True,
-		 GrabModeAsync, GrabModeAsync);
-	if (numlockmask) {
-		XGrabKey(display.dpy, keycode, modmask|numlockmask, w, True,
-			 GrabModeAsync, GrabModeAsync);
-		XGrabKey(display.dpy, keycode, modmask|numlockmask|LockMask, w, True,
-			 GrabModeAsync, GrabModeAsync);
+// Map each keycode back to the keysym bind_handle() would have compared, and
+// add an entry for every bind on that keysym.  Where two binds collide, the
+// first in the list wins, as it would have when the list was searched.
+
+static void bind_rebuild_dispatch(void) {
+	int min_keycode, max_keycode;
+	hash_clear(&dispatch);
+	XDisplayKeycodes(display.dpy, &min_keycode, &max_keycode);
+	for (struct list *l = controls; l; l = l->next) {
+		struct bind *b = l->data;
+		if (b->type == ButtonPress) {
+			if (b->control.button > 0xff)
+				continue;
+			unsigned long key = dispatch_key(ButtonPress, b->control.button, b->state);
+			if (!hash_find(&dispatch, key))
+				hash_insert(&dispatch, key, b);
+			continue;
+		}
+		for (int kc = min_keycode; kc <= max_keycode; kc++) {
+			if (XkbKeycodeToKeysym(display.dpy, kc, 0, 0) != b->control.key)
+				continue;
+			unsigned long key = dispatch_key(KeyPress, kc, b->state);
+			if (!hash_find(&dispatch, key))
+				hash_insert(&dispatch, key, b);
+		}
 	}
 }
 
-static void grab_button(unsigned button, unsigned modifiers, Window w) {
-	XGrabButton(display.dpy, button, modifiers, w,
-		    False, ButtonPressMask | ButtonReleaseMask,
-		    GrabModeAsync, GrabModeSync, None, None);
-	XGrabButton(display.dpy, button, modifiers|LockMask, w,
-		    False, ButtonPressMask | ButtonReleaseMask,
-		    GrabModeAsync, GrabModeSync, None, None);
+// Grabs are tracked as sets of keys in the same form as the dispatch table,
+// but with the exact modifier state passed to the server (including Lock and
+// NumLock variants).  Each screen's root and each client frame refers to the
+// set last applied to it, so regrabbing only sends requests for the
+// difference.  All frames share one set.
+
+struct grabset {
+	unsigned refs;
+	unsigned n;
+	unsigned long grab[];  // sorted
+};
+
+static struct grabset *root_grabs;
+static struct grabset *frame_grabs;
+
+static void grabset_unref(struct grabset *gs) {
+	if (gs && --gs->refs == 0)
+		free(gs);
+}
+
+static int grab_cmp(const void *a, const void *b) {
+	unsigned long ga = *(const unsigned long *)a, gb = *(const unsigned long *)b;
+	return (ga > gb) - (ga < gb);
+}
+
+static unsigned add_grabs(unsigned long *grab, unsigned n, int type, unsigned code, unsigned state) {
+	unsigned long key = ((unsigned long)state << 9) | (code << 1) | (type == ButtonPress);
+	grab[n++] = key;
+	grab[n++] = key | (LockMask << 9);
 	if (numlockmask) {
-		XGrabButton(display.dpy, button, modifiers|numlockmask, w,
-			    False, ButtonPressMask | ButtonReleaseMask,
-			    GrabModeAsync, GrabModeSync, None, None);
-		XGrabButton(display.dpy, button, modifiers|numlockmask|LockMask, w,
-			    False, ButtonPressMask | ButtonReleaseMask,
-			    GrabModeAsync, GrabModeSync, None, None);
+		grab[n++] = key | ((unsigned long)numlockmask << 9);
+		grab[n++] = key | ((unsigned long)(numlockmask|LockMask) << 9);
 	}
+	return n;
 }
 
-void bind_grab_for_screen(struct screen *s) {
-	XUngrabKey(display.dpy, AnyKey, AnyModifier, s->root);
-	XUngrabButton(display.dpy, AnyButton, AnyModifier, s->root);
+// Replace *gsp with a new set built from 'grab', unless identical
+
+static void grabset_update(struct grabset **gsp, unsigned long *grab, unsigned n) {
+	unsigned nuniq = 0;
+	qsort(grab, n, sizeof(grab[0]), grab_cmp);
+	for (unsigned i = 0; i < n; i++) {
+		if (nuniq == 0 || grab[i] != grab[nuniq-1])
+			grab[nuniq++] = grab[i];
+	}
+	struct grabset *gs = *gsp;
+	if (gs && gs->n == nuniq && !memcmp(gs->grab, grab, nuniq * sizeof(grab[0])))
+		return;
+	grabset_unref(gs);
+	gs = xmalloc(sizeof(*gs) + nuniq * sizeof(grab[0]));
+	gs->refs = 1;
+	gs->n = nuniq;
+	memcpy(gs->grab, grab, nuniq * sizeof(grab[0]));
+	*gsp = gs;
+}
 
+static void bind_rebuild_grabsets(void) {
+	unsigned nbinds = 0;
+	for (struct list *l = controls; l; l = l->next)
+		nbinds++;
+	unsigned long *rgrab = xmalloc((4 * nbinds + 1) * sizeof(*rgrab));
+	unsigned long *fgrab = xmalloc((4 * nbinds + 1) * sizeof(*fgrab));
+	unsigned nr = 0, nf = 0;
 	for (struct list *l = controls; l; l = l->next) {
 		struct bind *b = l->data;
 		if (b->type == KeyPress) {
-			grab_keysym(b->control.key, b->state, s->root);
-		}
-		else if (b->type == ButtonPress && !(b->flags & FL_CLIENT)) {
-			grab_button(b->control.button, b->state, s->root);
+			KeyCode keycode = XKeysymToKeycode(display.dpy, b->control.key);
+			// Keycode 0 would be AnyKey
+			if (keycode)
+				nr = add_grabs(rgrab, nr, KeyPress, keycode, b->state);
+		} else if (b->type == ButtonPress && b->control.button <= 0xff) {
+			if (!(b->flags & FL_CLIENT))
+				nr = add_grabs(rgrab, nr, ButtonPress, b->control.button, b->state);
+			nf = add_grabs(fgrab, nf, ButtonPress, b->control.button, b->state);
 		}
 	}
+	grabset_update(&root_grabs, rgrab, nr);
+	grabset_update(&frame_grabs, fgrab, nf);
+	free(rgrab);
+	free(fgrab);
 }
 
-void bind_grab_for_client(struct client *c) {
-	XUngrabButton(display.dpy, AnyButton, AnyModifier, c->parent);
+static void grab_one(unsigned long key, Window w) {
+	unsigned code = (key >> 1) & 0xff;
+	unsigned state = key >> 9;
+	if (key & 1) {
+		XGrabButton(display.dpy, code, state, w,
+			    False, ButtonPressMask | ButtonReleaseMask,
+			    GrabModeAsync, GrabModeSync, None, None);
+	} else {
+		XGrabKey(display.dpy, code, state, w, True,
+			 GrabModeAsync, GrabModeAsync);
+	}
+}
 
-	for (struct list *l = controls; l; l = l->next) {
-		struct bind *b = l->data;
-		if (b->type == ButtonPress) {
-			grab_button(b->control.button, b->state, c->parent);
+static void ungrab_one(unsigned long key, Window w) {
+	unsigned code = (key >> 1) & 0xff;
+	unsigned state = key >> 9;
+	if (key & 1) {
+		XUngrabButton(display.dpy, code, state, w);
+	} else {
+		XUngrabKey(display.dpy, code, state, w);
+	}
+}
+
+// Bring window's grabs from set *have to set 'want'
+
+static void apply_grabs(Window w, struct grabset **have, struct grabset *want) {
+	struct grabset *old = *have;
+	if (old == want)
+		return;
+	unsigned nold = old ? old->n : 0;
+	unsigned nwant = want ? want->n : 0;
+	unsigned i = 0, j = 0;
+	while (i < nold || j < nwant) {
+		if (j >= nwant || (i < nold && old->grab[i] < want->grab[j])) {
+			ungrab_one(old->grab[i++], w);
+		} else if (i >= nold || want->grab[j] < old->grab[i]) {
+			grab_one(want->grab[j++], w);
+		} else {
+			i++;
+			j++;
 		}
 	}
+	if (want)
+		want->refs++;
+	grabset_unref(old);
+	*have = want;
+}
+
+void bind_grab_for_screen(struct screen *s) {
+	bind_rebuild_dispatch();
+	bind_rebuild_grabsets();
+	apply_grabs(s->root, &s->grabs, root_grabs);
+}
+
+void bind_grab_for_client(struct client *c) {
+	apply_grabs(c->parent, &c->grabs, frame_grabs);
+}
+
+void bind_forget_grabs(struct grabset **grabs) {
+	grabset_unref(*grabs);
+	*grabs = NULL;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -534,17 +661,12 @@ void bind_grab_for_client(struct client *c) {
 
 void bind_handle(XKeyEvent *e) {
 	if (e->type != KeyPress && e->type != ButtonPress) return;
-	for (struct list *l = controls; l; l = l->next) {
-		struct bind *bind = l->data;
-		if (bind->type != e->type) continue;
-		if (bind->type == KeyPress
-			&& XkbKeycodeToKeysym(display.dpy, e->keycode, 0, 0) != bind->control.key) continue;
-		if (bind->type == ButtonPress
-			&& ((XButtonEvent *)e)->button != bind->control.button) continue;
-		if (bind->type == ButtonPress
-			&& !e->subwindow) e->state |= grabmask2; // TODO: replace with mask specific to borders
-		if ( (e->state & KEY_STATE_MASK & ~numlockmask)
-			!= (bind->state & ~numlockmask) ) continue;
+	if (e->type == ButtonPress && !e->subwindow)
+		e->state |= grabmask2; // TODO: replace with mask specific to borders
+	struct bind *bind = NULL;
+	if (e->keycode <= 0xff)
+		bind = hash_find(&dispatch, dispatch_key(e->type, e->keycode, e->state));
+	if (bind) {
 		void *sptr = NULL;
 		if (bind->flags & FL_CLIENT)
 			sptr = bind->type == KeyPress ? current : find_client(e->window);
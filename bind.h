@@ -12,6 +12,7 @@
 #include <X11/Xlib.h>
 
 struct client;
+struct grabset;
 struct screen;
 
 // Modifier binds are kept in an array of mappings:
@@ -50,12 +51,16 @@ void bind_modifier(const char *modname, const char *modspec);
 // Bind a control to a function + flags
 void bind_control(const char *ctlspec, const char *funcspec);
 
-// Apply grabs relevant to screen
+// Apply grabs relevant to screen.  Only changes since the last call are sent
+// to the server.
 void bind_grab_for_screen(struct screen *s);
 
 // Apply grabs relevant to client
 void bind_grab_for_client(struct client *c);
 
+// Drop record of grabs on a window that is being destroyed
+void bind_forget_grabs(struct grabset **grabs);
+
 void bind_handle(XKeyEvent *e);
 
 #endif
@@ -25,21 +25,33 @@
 #include <X11/extensions/shape.h>
 #endif
 
+#include "bind.h"
 #include "client.h"
 #include "display.h"
 #include "evilwm.h"
 #include "ewmh.h"
+#include "hash.h"
 #include "list.h"
 #include "log.h"
+#include "loop.h"
 #include "screen.h"
+#include "termpool.h"
 #include "util.h"
 
 // Client tracking information
-struct list *clients_tab_order = NULL; // head is most recent
-struct list *clients_mapping_order = NULL; // head is eldest
-struct list *clients_stacking_order = NULL; // head is furthest back
+struct dlist clients_tab_order = DLIST_INIT(struct client, tab); // head is most recent
+static struct dlist clients_dirty = DLIST_INIT(struct client, dirty_link);
+struct dlist clients_remove_queue = DLIST_INIT(struct client, remove_link);
 struct client *current = NULL;
 
+// Index of clients by both window and parent, for find_client()
+static struct hash client_index = { 0 };
+
+// Client to select once the pointer settles (see client_select_later())
+static struct client *select_pending = NULL;
+static void select_timeout(void *data);
+static struct loop_timer select_timer = { .fn = select_timeout };
+
 // Get WM_NORMAL_HINTS property.  Populates appropriate parts of the client
 // structure and returns the hint flags (which indicates whether sizes or
 // positions were user- or program-specified).
@@ -54,7 +66,15 @@ long get_wm_normal_hints(struct client *c) {
 	debug_wm_normal_hints(size);
 	LOG_XLEAVE();
 
-	flags = size->flags;
+	flags = set_wm_normal_hints(c, size);
+	XFree(size);
+	return flags;
+}
+
+// Update client from already-fetched WM_NORMAL_HINTS.
+
+long set_wm_normal_hints(struct client *c, XSizeHints *size) {
+	long flags = size->flags;
 
 	if (flags & PMinSize) {
 		c->min_width = size->min_width;
@@ -96,7 +116,6 @@ long get_wm_normal_hints(struct client *c) {
 	}
 	c->win_gravity = c->win_gravity_hint;
 
-	XFree(size);
 	return flags;
 }
 
@@ -117,16 +136,34 @@ void update_window_type_flags(struct client *c, unsigned type) {
 // Managed windows are all reparented, so most client operations act on the
 // parent window.
 
-// find_client() is used all over the place.  Return the client that has
-// specified window as either window or parent.  NULL if not found.
+// find_client() is used all over the place (most events, and X errors).
+// Return the client that has specified window as either window or parent.
+// NULL if not found.  Looked up in a hash index rather than scanning the
+// client list, so cost doesn't grow with the number of managed windows.
 
 struct client *find_client(Window w) {
-	for (struct list *iter = clients_tab_order; iter; iter = iter->next) {
-		struct client *c = iter->data;
-		if (w == c->parent || w == c->window)
-			return c;
-	}
-	return NULL;
+	return hash_find(&client_index, w);
+}
+
+// Add client to the index under both its window and its parent.  Called
+// when a client is first allocated (parent not yet created) and again once
+// it has been reparented.
+
+void client_index_insert(struct client *c) {
+	hash_insert(&client_index, c->window, c);
+	if (c->parent)
+		hash_insert(&client_index, c->parent, c);
+}
+
+// Remove client from the index.  Frees the index storage when the last
+// client goes.
+
+void client_index_delete(struct client *c) {
+	hash_delete(&client_index, c->window);
+	if (c->parent)
+		hash_delete(&client_index, c->parent);
+	if (!client_index.count)
+		hash_clear(&client_index);
 }
 
 static int imin(int a, int b) {
@@ -146,12 +183,19 @@ static int imax(int a, int b) {
 // for the purpose of maximising, etc.
 //
 // 'intersects' is set to represent whether client intersects with any monitor.
+//
+// The answer is cached in the client until its geometry or the screen's
+// monitor layout changes.  A frame lying entirely within one monitor (the
+// usual case) is looked up in the screen's monitor grid without scanning.
+
+static int find_monitor(struct client *c, int cx1, int cy1, int cx2, int cy2,
+                        Bool *intersects) {
+	int index = screen_monitor_covering(c->screen, cx1, cy1, cx2, cy2);
+	if (index >= 0) {
+		*intersects = 1;
+		return index;
+	}
 
-struct monitor *client_monitor(struct client *c, Bool *intersects) {
-	int cx1 = c->x - c->border;
-	int cy1 = c->y - c->border;
-	int cx2 = cx1 + c->width + c->border*2;
-	int cy2 = cy1 + c->height + c->border*2;
 #ifdef HAVE_MATH_H
 	int cmidx = (cx1 + cx2)/2;
 	int cmidy = (cy1 + cy2)/2;
@@ -211,23 +255,46 @@ struct monitor *client_monitor(struct client *c, Bool *intersects) {
 #endif
 	}
 
-	if (!best) {
-		best = &c->screen->monitors[0];
+	*intersects = have_intersection;
+	return best ? best - c->screen->monitors : 0;
+}
+
+struct monitor *client_monitor(struct client *c, Bool *intersects) {
+	struct screen *s = c->screen;
+	struct monitor_cache *mc = &c->mon_cache;
+	int cx1 = c->x - c->border;
+	int cy1 = c->y - c->border;
+	int cx2 = cx1 + c->width + c->border*2;
+	int cy2 = cy1 + c->height + c->border*2;
+
+	if (mc->serial != s->monitors_serial || mc->name != c->mon_name
+	    || mc->x1 != cx1 || mc->y1 != cy1 || mc->x2 != cx2 || mc->y2 != cy2) {
+		*mc = (struct monitor_cache){
+			.x1 = cx1, .y1 = cy1, .x2 = cx2, .y2 = cy2,
+			.name = c->mon_name,
+			.serial = s->monitors_serial,
+		};
+		mc->index = find_monitor(c, cx1, cy1, cx2, cy2, &mc->intersects);
 	}
 	if (intersects) {
-		*intersects = have_intersection;
+		*intersects = mc->intersects;
 	}
-	return best;
+	return &s->monitors[mc->index];
 }
 
 // "Hides" the client (unmaps and flags it as iconified).  Used to simulate
-// virtual desktops by hiding all clients not on the current vdesk.
+// virtual desktops by hiding all clients not on the current vdesk.  Frames
+// in a vdesk container are left mapped: the container is hidden instead.
+// WM_STATE is updated by client_commit().
 
 void client_hide(struct client *c) {
 	LOG_DEBUG("hiding window=%lx\n", (unsigned long)c->window);
-	c->ignore_unmap++;  // ignore unmap so we don't remove client
-	XUnmapWindow(display.dpy, c->parent);
-	set_wm_state(c, IconicState);
+	if (c->mapped && c->container == c->screen->root) {
+		c->ignore_unmap++;  // ignore unmap so we don't remove client
+		XUnmapWindow(display.dpy, c->parent);
+		c->mapped = 0;
+	}
+	client_dirty(c, CLIENT_DIRTY_WM_STATE);
 	if (current == c) {
 		client_select(NULL);
 	}
@@ -238,8 +305,11 @@ void client_hide(struct client *c) {
 
 void client_show(struct client *c) {
 	LOG_DEBUG("showing window=%lx\n",(unsigned long)c->window);
-	XMapWindow(display.dpy, c->parent);
-	set_wm_state(c, NormalState);
+	if (!c->mapped) {
+		XMapWindow(display.dpy, c->parent);
+		c->mapped = 1;
+	}
+	client_dirty(c, CLIENT_DIRTY_WM_STATE);
 }
 
 // Test for overlap
@@ -255,32 +325,72 @@ _Bool client_client(struct client *c, struct client *cc) {
 	return 1;
 }
 
+// Stack frames to match their screen's stacking order, for any clients
+// flagged CLIENT_DIRTY_STACKING.  Frames that weren't moved are still in the
+// right order relative to each other, so this need only restack from the
+// first unmoved frame above the highest moved one down to the lowest moved
+// one, in a single XRestackWindows().  Frames in different vdesk containers
+// are not siblings, so each container gets its own.
+
+static void restack_frames(struct screen *s) {
+	static struct window_array a;
+	for (;;) {
+		struct client *low = s->stacking.head;
+		while (low && !(low->dirty & CLIENT_DIRTY_STACKING))
+			low = low->stacking.next;
+		if (!low)
+			return;
+		struct client *above = NULL;
+		a.n = 0;
+		for (struct client *c = s->stacking.tail; c; c = c->stacking.prev) {
+			if (c->container != low->container)
+				continue;
+			if (!a.n) {
+				if (!(c->dirty & CLIENT_DIRTY_STACKING)) {
+					above = c;
+					continue;
+				}
+				if (above) {
+					window_array_add(&a, above->parent);
+				} else {
+					LOG_XDEBUG("XRaiseWindow(window=%lx,parent=%lx)\n", (unsigned long)c->window, (unsigned long)c->parent);
+					XRaiseWindow(display.dpy, c->parent);
+				}
+			}
+			c->dirty &= ~CLIENT_DIRTY_STACKING;
+			window_array_add(&a, c->parent);
+			if (c == low)
+				break;
+		}
+		if (a.n > 1) {
+			LOG_XDEBUG("XRestackWindows(%u windows)\n", a.n);
+			XRestackWindows(display.dpy, a.w, a.n);
+		}
+	}
+}
+
 // Place 'under' directly under 'over'
-// Maintains clients_stacking_order list and EWMH hints
+// Maintains screen's stacking order list and EWMH hints.  The frame itself
+// is restacked by client_commit(), so that a series of changes costs one
+// request.
 void client_under(struct client *under, struct client *over) {
 	if (!under) {
 		LOG_ERROR("client_under(): null under!\n");
 		return;
 	}
+	struct dlist *stacking = &under->screen->stacking;
 	if (!over) {
-		LOG_XDEBUG("XRaiseWindow(window=%lx,parent=%lx)\n", (unsigned long)under->window, (unsigned long)under->parent);
-		XRaiseWindow(display.dpy, under->parent);
-		clients_stacking_order=list_to_tail(clients_stacking_order,under);
-		ewmh_set_net_client_list_stacking(under->screen);
-		return;
-	}
-	LOG_XDEBUG("XRestackWindows({window=%lx,parent=%lx},{window=%lx,parent=%lx})\n",
-		(unsigned long)over->window, (unsigned long)over->parent,
-		(unsigned long)under->window, (unsigned long)under->parent);
-	XRestackWindows(display.dpy, (Window[]){ over->parent, under->parent }, 2);
-	clients_stacking_order = list_delete(clients_stacking_order, under); // XXX can this be omitted?
-	if (clients_stacking_order->data == over) {
-		clients_stacking_order = list_prepend(clients_stacking_order, under);
+		dlist_to_tail(stacking, under);
 	} else {
-		struct list *pover = list_find_prev(clients_stacking_order, over);
-		pover->next = list_prepend(pover->next, under);
-	}
-	ewmh_set_net_client_list_stacking(under->screen);
+		// Clients on different screens can't be stacked relative to
+		// each other
+		if (under == over || under->screen != over->screen)
+			return;
+		dlist_delete(stacking, under);
+		dlist_insert_before(stacking, under, over);
+	}
+	client_dirty(under, CLIENT_DIRTY_STACKING);
+	under->screen->dirty |= SCREEN_DIRTY_CLIENT_LIST_STACKING;
 }
 
 // Raise client
@@ -291,26 +401,19 @@ void client_raise(struct client *c) {
 		return;
 	}
 #if defined(LOWERRAISE_OVERLAP) || defined(LOWERRAISE_VISIBLE)
-	struct list *iter = clients_stacking_order;
-	while (iter && iter->data!=c) iter = iter->next;
-	if (!iter) { // list-/>c, must be added
-		iter = clients_stacking_order = list_prepend(clients_stacking_order, c);
-	}
-	struct list *cnode = iter;
-	struct list *last = iter;
-	while ((iter=iter->next)) {
-		struct client *cc = iter->data;
-		if (!cc) continue; // skip null data
-		if (cc==c) LOG_DEBUG("duplicate node for window=%lx in clients_stacking_order\n", c->window);
+	if (!dlist_contains(&c->screen->stacking, c)) // must be added
+		dlist_prepend(&c->screen->stacking, c);
+	struct client *last = c;
+	for (struct client *cc = c->stacking.next; cc; cc = cc->stacking.next) {
 		if (!is_visible(cc)) continue; // wrong vdesk
 #ifdef LOWERRAISE_OVERLAP
 		if (!client_client(c,cc)) continue; // no collide
 #endif
-		last = iter;
+		last = cc;
 	}
 	// last is last/highest overlap
-	if (cnode==last) return; // already on top
-	if (last->next) client_under(c,last->next->data);
+	if (last == c) return; // already on top
+	if (last->stacking.next) client_under(c, last->stacking.next);
 	else // tail
 #endif
 	client_under(c,NULL);
@@ -323,20 +426,18 @@ void client_lower(struct client *c) {
 		LOG_ERROR("client_lower(): null client!\n");
 		return;
 	}
-	struct list *iter = clients_stacking_order;
-	if (!iter) { // in an environment of no clients, raising is as lowering
+	struct client *bottom = c->screen->stacking.head;
+	if (!bottom) { // in an environment of no clients, raising is as lowering
 		LOG_ERROR("client_lower(): null list!\n");
 		LOG_XDEBUG("XLowerWindow(window=%lx,parent=%lx)\n", (unsigned long)c->window, (unsigned long)c->parent);
 		XLowerWindow(display.dpy, c->parent);
-		clients_stacking_order = list_to_head(clients_stacking_order, c);
-		ewmh_set_net_client_list_stacking(c->screen);
+		dlist_to_head(&c->screen->stacking, c);
+		c->screen->dirty |= SCREEN_DIRTY_CLIENT_LIST_STACKING;
 		return;
 	}
 #if defined(LOWERRAISE_OVERLAP) || defined(LOWERRAISE_VISIBLE)
-	iter=&(struct list){ .next=iter, .data=NULL };
-	while ((iter=iter->next)) {
-		struct client *cc = iter->data;
-		if (!cc) continue; // skip null data
+	struct client *cc;
+	for (cc = bottom; cc; cc = cc->stacking.next) {
 		if (cc==c) return; // nothing underneath
 		if (!is_visible(cc)) continue; // wrong vdesk
 #ifdef LOWERRAISE_OVERLAP
@@ -344,13 +445,13 @@ void client_lower(struct client *c) {
 #endif
 		break;
 	}
-	// iter is first/lowest overlap
-	if (iter) client_under(c,iter->data);
+	// cc is first/lowest overlap
+	if (cc) client_under(c,cc);
 	else // no overlap & list-/>c
-		client_under(c,clients_stacking_order->data);
+		client_under(c,bottom);
 #else
-	if (iter->data==c) return; // already at bottom
-	client_under(c,iter->data);
+	if (bottom==c) return; // already at bottom
+	client_under(c,bottom);
 #endif
 }
 
@@ -440,6 +541,9 @@ void client_gravitate(struct client *c, int bw) {
 
 void client_select(struct client *c) {
 	struct client *old_current = current;
+	// Explicit selection supersedes any pending one
+	loop_timer_stop(&select_timer);
+	select_pending = NULL;
 	if (old_current)
 		XSetWindowBorder(display.dpy, current->parent, current->screen->bg.pixel);
 	if (c) {
@@ -451,9 +555,40 @@ void client_select(struct client *c) {
 	current = c;
 
 	if (old_current)
-		ewmh_set_net_wm_state(old_current);
+		client_dirty(old_current, CLIENT_DIRTY_NET_WM_STATE);
 	if (c)
-		ewmh_set_net_wm_state(c);
+		client_dirty(c, CLIENT_DIRTY_NET_WM_STATE);
+}
+
+// Select a client the pointer has entered, once it's rested there for
+// option.focusdelay ms.  A run of EnterNotify events while sweeping the
+// pointer across windows then only changes focus once, to wherever it ends
+// up.  With no delay, selects immediately.
+
+void client_select_later(struct client *c) {
+	if (option.focusdelay <= 0) {
+		client_select(c);
+		dlist_to_head(&clients_tab_order, c);
+		return;
+	}
+	if (c == current) {
+		// Back where we started: nothing to change
+		loop_timer_stop(&select_timer);
+		select_pending = NULL;
+		return;
+	}
+	select_pending = c;
+	loop_timer_start(&select_timer, option.focusdelay);
+}
+
+static void select_timeout(void *data) {
+	(void)data;
+	struct client *c = select_pending;
+	select_pending = NULL;
+	if (c && is_visible(c)) {
+		client_select(c);
+		dlist_to_head(&clients_tab_order, c);
+	}
 }
 
 int client_point(struct client *c, int margin_l, int margin_u, int margin_r, int margin_d) {
@@ -495,6 +630,7 @@ void client_to_vdesk(struct client *c, unsigned vdesk) {
 		LOG_DEBUG("window=%lx to vdesk %u\n",(unsigned long)c->window,vdesk);
 		_Bool was_visible = is_visible(c);
 		c->vdesk = vdesk;
+		client_update_container(c);
 		if (is_visible(c))
 			{ if (!was_visible) client_show(c); }
 		else
@@ -504,17 +640,57 @@ void client_to_vdesk(struct client *c, unsigned vdesk) {
 	}
 }
 
+// Which window a client's frame should be a child of.  While the screen uses
+// vdesk containers, that's the container for its vdesk, unless it's fixed or
+// a dock, or all vdesks are being shown at once.
+
+static Window client_container(struct client *c) {
+	struct screen *s = c->screen;
+	if (!screen_uses_containers(s) || c->is_dock || s->vdesk == VDESK_FIXED
+	    || c->vdesk >= option.vdesks)
+		return s->root;
+	return screen_container(s, c->vdesk);
+}
+
+// Move a client's frame to the window it should now be a child of.  Frames
+// in a container are always mapped; frames on the root are mapped only if
+// visible.
+
+void client_update_container(struct client *c) {
+	Window container = client_container(c);
+	if (container == c->container)
+		return;
+	LOG_DEBUG("window=%lx to container %lx\n", (unsigned long)c->window, (unsigned long)container);
+	// Reparenting a mapped frame unmaps it first, and the root will tell
+	// us about that
+	if (c->mapped && c->container == c->screen->root)
+		c->ignore_unmap++;
+	XReparentWindow(display.dpy, c->parent, container,
+	                c->x - c->border, c->y - c->border);
+	c->container = container;
+	client_dirty(c, CLIENT_DIRTY_STACKING);
+	if (container != c->screen->root) {
+		if (!c->mapped) {
+			XMapWindow(display.dpy, c->parent);
+			c->mapped = 1;
+		}
+	} else if (is_visible(c)) {
+		client_show(c);
+	} else {
+		client_hide(c);
+	}
+}
+
 // Stop managing a client.  Undoes any transformations that were made when
 // managing it.
 
 void client_remove(struct client *c) {
 	LOG_ENTER("client_remove(window=%lx, %s)", (unsigned long)c->window, c->remove ? "withdrawing" : "wm quitting");
 
-	// Flag to ignore any X errors we trigger.  The window may well already
-	// have been deleted from the server, so anything we try to do to it
-	// here would raise one.
-	removing = c->window;
-	removing_parent = c->parent;
+	// Ignore any X errors we trigger.  The window may well already have
+	// been deleted from the server, so anything we try to do to it here
+	// would raise one.
+	xerror_ignore_begin(c->window);
 
 	// ICCCM 4.1.3.1
 	// "When the window is withdrawn, the window manager will either change
@@ -532,62 +708,100 @@ void client_remove(struct client *c) {
 			XSetInputFocus(display.dpy, PointerRoot, RevertToPointerRoot,
 			               CurrentTime);
 		}
-		set_wm_state(c, WithdrawnState);
-		ewmh_withdraw_client(c);
+		if (!c->destroyed) {
+			set_wm_state(c, WithdrawnState);
+			ewmh_withdraw_client(c);
+		}
 	} else {
 		ewmh_remove_allowed_actions(c);
 	}
 
-	// Undo the geometry changes applied when we managed the client
-	client_gravitate(c, -c->border);
-	client_gravitate(c, c->old_border);
-	c->x -= c->old_border;
-	c->y -= c->old_border;
+	// Nothing more to do to a window that no longer exists
+	if (!c->destroyed) {
+		// Undo the geometry changes applied when we managed the client
+		client_gravitate(c, -c->border);
+		client_gravitate(c, c->old_border);
+		c->x -= c->old_border;
+		c->y -= c->old_border;
 
-	// Reparent window back to the root
-	XReparentWindow(display.dpy, c->window, c->screen->root, c->x, c->y);
+		// Reparent window back to the root
+		XReparentWindow(display.dpy, c->window, c->screen->root, c->x, c->y);
 
-	// Restore any old border
-	XSetWindowBorderWidth(display.dpy, c->window, c->old_border);
+		// Restore any old border
+		XSetWindowBorderWidth(display.dpy, c->window, c->old_border);
 
-	// Remove window from "save set": we are no longer its parent, so if we
-	// die now, the window should be fine.
-	XRemoveFromSaveSet(display.dpy, c->window);
+		// Remove window from "save set": we are no longer its parent,
+		// so if we die now, the window should be fine.
+		XRemoveFromSaveSet(display.dpy, c->window);
+	}
 
 	// Destroy parent window
 	if (c->parent) {
 		XDestroyWindow(display.dpy, c->parent);
 	}
+	bind_forget_grabs(&c->grabs);
+	termpool_forget(c);
 
 	// Remove from the client lists
-	clients_tab_order = list_delete(clients_tab_order, c);
-	clients_mapping_order = list_delete(clients_mapping_order, c);
-	clients_stacking_order = list_delete(clients_stacking_order, c);
+	client_index_delete(c);
+	dlist_delete(&clients_tab_order, c);
+	dlist_delete(&c->screen->mapping, c);
+	dlist_delete(&c->screen->stacking, c);
 
 	// If the wm is quitting, we'll remove the client list properties
-	// soon enough, otherwise, update them:
-	if (c->remove) {
-		ewmh_set_net_client_list(c->screen);
-		ewmh_set_net_client_list_stacking(c->screen);
-	}
-
-	// Deselect if this client were previously selected
-	if (current == c) client_select(NULL);
+	// soon enough, otherwise, update them.  Either way, the client list
+	// must forget it, as clients may be managed again.
+	ewmh_client_list_remove(c);
+	if (c->remove)
+		c->screen->dirty |= SCREEN_DIRTY_CLIENT_LIST_STACKING;
+
+	// Deselect if this client were previously selected.  Not with
+	// client_select(), which would cancel any pending selection of the
+	// client the pointer is now over.
+	if (current == c)
+		current = NULL;
+	if (select_pending == c) {
+		loop_timer_stop(&select_timer);
+		select_pending = NULL;
+	}
+
+	// Any pending property updates are moot now, but the root must stop
+	// naming this window as active.
+	dlist_delete(&clients_dirty, c);
+	dlist_delete(&clients_remove_queue, c);
+	if (c->screen->active == c->window)
+		ewmh_set_net_active_window(c->screen, None);
 	free(c);
 
 #ifdef DEBUG
 	{
 		int i = 0;
-		for (struct list *iter = clients_tab_order; iter; iter = iter->next)
+		for (struct client *iter = clients_tab_order.head; iter; iter = iter->tab.next)
 			i++;
 		LOG_DEBUG("free(), window count now %d\n", i);
 	}
 #endif
 
-	// removing = None;
+	xerror_ignore_end();
 	LOG_LEAVE();
 }
 
+// Queue a client for removal by client_remove_queued().  Its window has been
+// withdrawn (or destroyed), but events already queued may still refer to it,
+// so it's removed once the current batch has been handled.
+
+void client_remove_later(struct client *c) {
+	if (c->remove)
+		return;
+	c->remove = 1;
+	dlist_append(&clients_remove_queue, c);
+}
+
+void client_remove_queued(void) {
+	while (clients_remove_queue.head)
+		client_remove(clients_remove_queue.head);
+}
+
 // Delete a window.  Sends WM_DELETE_WINDOW to a client if that protocol is
 // found to be supported.  Otherwise (or if forced by setting kill_client), use
 // XKillClient (terminates its connection to the server).
@@ -706,3 +920,36 @@ void remove_info_window(void) {
 }
 
 #endif
+
+// Flag client properties as needing update.  They're written out together by
+// client_commit() once the current batch of events has been handled.
+
+void client_dirty(struct client *c, unsigned flags) {
+	if (!c->dirty)
+		dlist_append(&clients_dirty, c);
+	c->dirty |= flags;
+}
+
+// Restack any frames now, rather than waiting for client_commit().  For
+// code that needs to see the result before returning to the main loop.
+
+void client_commit_stacking(void) {
+	for (struct client *c = clients_dirty.head; c; c = c->dirty_link.next) {
+		if (c->dirty & CLIENT_DIRTY_STACKING)
+			restack_frames(c->screen);
+	}
+}
+
+void client_commit(void) {
+	struct client *c;
+	while ((c = clients_dirty.head)) {
+		dlist_delete(&clients_dirty, c);
+		if (c->dirty & CLIENT_DIRTY_STACKING)
+			restack_frames(c->screen);
+		if (c->dirty & CLIENT_DIRTY_NET_WM_STATE)
+			ewmh_set_net_wm_state(c);
+		if (c->dirty & CLIENT_DIRTY_WM_STATE)
+			set_wm_state(c, is_visible(c) ? NormalState : IconicState);
+		c->dirty = 0;
+	}
+}
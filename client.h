@@ -12,17 +12,38 @@
 #define EVILWM_CLIENT_H_
 
 #include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "list.h"
 
-struct list;
 struct screen;
+struct grabset;
 struct monitor;
+struct winprops;
 
 // Maximise flags
 #define MAXIMISE_HORZ   (1<<0)
 #define MAXIMISE_VERT   (1<<1)
 #define MAXIMISE_SCREEN (1<<2)  // maximise to screen, not monitor
 
+// Dirty flags: client properties (and frame stacking) that are out of date
+// and will be rewritten by client_commit()
+#define CLIENT_DIRTY_NET_WM_STATE (1<<0)
+#define CLIENT_DIRTY_WM_STATE     (1<<1)
+#define CLIENT_DIRTY_STACKING     (1<<2)  // frame needs restacking
+
+// Result of client_monitor(), valid while the frame rectangle, mon_name and
+// the screen's monitor layout are as recorded here
+struct monitor_cache {
+	int x1, y1, x2, y2;
+	Atom name;
+	unsigned serial;  // screen's monitors_serial; 0 for none cached
+	int index;
+	Bool intersects;
+};
+
 // Virtual desktop macros
+#define VDESK_POOL  (0xfffffffd) // hidden terminal pool (see termpool.h)
 #define VDESK_NONE  (0xfffffffe) // used for app selection
 #define VDESK_FIXED (0xffffffff)
 #define valid_vdesk(v) ((v) == VDESK_FIXED || (v) < option.vdesks)
@@ -30,6 +51,7 @@ struct monitor;
 struct client {
 	Window window;  // actual application window
 	Window parent;  // parent window that we control
+	Window container;  // parent of frame: root, or a vdesk container
 	struct screen *screen;  // screen this client is on
 	Colormap cmap;  // colourmap to install when focussed
 
@@ -40,6 +62,10 @@ struct client {
 	// disappearing, flagged here:
 	int ignore_unmap;
 
+	// Whether the frame is mapped.  It may still be hidden by an unmapped
+	// vdesk container.
+	int mapped;
+
 	// Geometry
 	int x, y, width, height;
 	int normal_border;  // normal border when unmaximised
@@ -57,8 +83,13 @@ struct client {
 	// Keep track of monitor, and save most recent when it disappears
 	Atom mon_name; int mon_save;
 
-	// Flag set when we need to remove client from management
+	// Last client_monitor() result
+	struct monitor_cache mon_cache;
+
+	// Flag set when we need to remove client from management (and it's
+	// on the removal queue), and whether the window is already destroyed
 	int remove;
+	int destroyed;
 
 	// Various window metadata determined by examining properties
 	int min_width, min_height;
@@ -71,22 +102,41 @@ struct client {
 #ifdef CONFIGREQ
 	int ignore_configreq;
 #endif
+
+	// Properties needing update (CLIENT_DIRTY_*)
+	unsigned dirty;
+
+	// Button grabs on parent
+	struct grabset *grabs;
+
+	// Link into tab order list below, and into its screen's mapping and
+	// stacking order lists
+	struct dlist_link tab;
+	struct dlist_link mapping;
+	struct dlist_link stacking;
+	// Link into list of clients with dirty flags set
+	struct dlist_link dirty_link;
+	// Link into removal queue
+	struct dlist_link remove_link;
 };
 
-// Client tracking information
-extern struct list *clients_tab_order;
-extern struct list *clients_mapping_order;
-extern struct list *clients_stacking_order;
+// Client tracking information.  Mapping and stacking orders are kept per
+// screen (see struct screen).
+extern struct dlist clients_tab_order;
+extern struct dlist clients_remove_queue;
 extern struct client *current;
 
 #define is_fixed(c) ((c)->vdesk == VDESK_FIXED)
-#define on_vdesk(c) (is_fixed(c)||(c)->screen->vdesk==VDESK_FIXED||(c)->vdesk==(c)->screen->vdesk)
+#define on_vdesk(c) ((c)->vdesk!=VDESK_POOL && (is_fixed(c)||(c)->screen->vdesk==VDESK_FIXED||(c)->vdesk==(c)->screen->vdesk))
 #define is_visible(c) ( (!(c)->is_dock || (c)->screen->docks_visible) && on_vdesk(c) )
 
 // client_new.c: newly manage a window
 
-void client_manage_new(Window w, struct screen *s);
+void client_manage_new(struct winprops *wp, struct screen *s);
+void client_place_at_pointer(struct client *c, int x, int y);
+void client_replace_border(struct client *c);
 long get_wm_normal_hints(struct client *c);
+long set_wm_normal_hints(struct client *c, XSizeHints *size);
 void get_window_type(struct client *c);
 void update_window_type_flags(struct client *c, unsigned type);
 
@@ -104,6 +154,8 @@ void client_select_next(void);
 // client.c: various other client functions
 
 struct client *find_client(Window w);
+void client_index_insert(struct client *c);
+void client_index_delete(struct client *c);
 struct monitor *client_monitor(struct client *c, Bool *intersects);
 _Bool client_client(struct client *c, struct client *cc);
 void client_hide(struct client *c);
@@ -113,9 +165,16 @@ void client_raise(struct client *c);
 void client_lower(struct client *c);
 void client_gravitate(struct client *c, int bw);
 void client_select(struct client *c);
+void client_select_later(struct client *c);
 int client_point(struct client *c, int margin_l, int margin_u, int margin_r, int margin_d);
 void client_to_vdesk(struct client *c, unsigned vdesk);
+void client_update_container(struct client *c);
 void client_remove(struct client *c);
+void client_remove_later(struct client *c);
+void client_remove_queued(void);
+void client_dirty(struct client *c, unsigned flags);
+void client_commit(void);
+void client_commit_stacking(void);
 
 void send_config(struct client *c);
 void send_wm_delete(struct client *c, int kill_client);
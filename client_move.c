@@ -13,7 +13,11 @@
 #include <string.h>
 
 #include <X11/X.h>
+#include <X11/Xatom.h>
 #include <X11/Xlib.h>
+#ifdef XSYNC
+#include <X11/extensions/sync.h>
+#endif
 
 #include "bind.h"
 #include "client.h"
@@ -23,6 +27,53 @@
 #include "list.h"
 #include "screen.h"
 #include "util.h"
+#include "xalloc.h"
+
+// Outline shown in place of the window during non-solid drags & sweeps.
+// Style is selected at runtime by the "outline" option from those built in:
+//
+// window - four thin override-redirect windows forming a frame, so moving
+//          it is just a few configure requests
+// shape  - the client frame itself, shaped down to its border (SHAPE_OUTLINE)
+// invert - drawn on the root with the inverting GC (GC_INVERT).  The server
+//          is grabbed while it is shown, so that nothing draws over it.
+
+enum outline_style {
+	OUTLINE_WINDOW,
+	OUTLINE_SHAPE,
+	OUTLINE_INVERT,
+};
+
+struct outline {
+	enum outline_style style;
+	_Bool shown;
+#ifdef GC_INVERT
+	struct client *drawn;  // invert: copy of client as last drawn
+#endif
+};
+
+static void window_outline(struct client *c) {
+	struct screen *s = c->screen;
+	if (s->outline[0] == None) {
+		XSetWindowAttributes attr = {
+			.background_pixel = s->fg.pixel,
+			.override_redirect = True,
+		};
+		for (int i = 0; i < 4; i++) {
+			s->outline[i] = XCreateWindow(display.dpy, s->root, 0, 0, 1, 1, 0,
+					CopyFromParent, InputOutput, CopyFromParent,
+					CWBackPixel|CWOverrideRedirect, &attr);
+		}
+	}
+	int t = c->border > 0 ? c->border : 1;
+	int x = c->x - c->border, y = c->y - c->border;
+	int w = c->width + 2*c->border, h = c->height + 2*c->border;
+	int side = h > 2*t ? h - 2*t : 1;
+	XMoveResizeWindow(display.dpy, s->outline[0], x, y, w, t);
+	XMoveResizeWindow(display.dpy, s->outline[1], x, y + h - t, w, t);
+	XMoveResizeWindow(display.dpy, s->outline[2], x, y + t, t, side);
+	XMoveResizeWindow(display.dpy, s->outline[3], x + w - t, y + t, t, side);
+}
 
 ////////////////////////////////
 #ifdef SHAPE_OUTLINE
@@ -65,13 +116,10 @@ static void do_outline(struct client *c, _Bool set) {
 	XDestroyRegion(region);
 	XDestroyRegion(holed);
 }
-# define init_outline(...)
-# define set_outline(c) do_outline(c, 1)
-# define clear_outline(c) { if (c != NULL) do_outline(c, 0); }
+#endif
 
 ////////////////////////////////
-#elif defined(GC_INVERT)
-#include "xalloc.h"
+#ifdef GC_INVERT
 // Use the inverting graphics context to draw an outline for the client.
 // Drawing it a second time will erase it.  If INFOBANNER_MOVERESIZE is
 // defined, the information window is shown for the duration (but this can be
@@ -98,7 +146,7 @@ static void draw_outline(struct client *c) {
 #endif
 }
 
-static void clear_outline(struct client *current_outline){
+static void clear_inverted(struct client *current_outline){
 	if (current_outline == NULL)
 		return;
 	draw_outline(current_outline);
@@ -106,31 +154,94 @@ static void clear_outline(struct client *current_outline){
 	free(current_outline);
 }
 
-static struct client *set_outline(struct client *c, struct client *current_outline){
-	clear_outline(current_outline);
+static struct client *set_inverted(struct client *c, struct client *current_outline){
+	clear_inverted(current_outline);
 	XSync(display.dpy, False);
 	XGrabServer(display.dpy);
 	draw_outline(c);
 	return xmemdup(c, sizeof(*c));
 }
-
-# define init_outline(c) struct client *outline_c = NULL
-# define set_outline(c) { outline_c = set_outline(c, outline_c); }
-# define clear_outline(c) { clear_outline(outline_c); outline_c = NULL; }
+#endif
 
 ////////////////////////////////
-#else
-# define init_outline(...)
-# define set_outline(...)
-# define clear_outline(...)
-////////////////////////////////
+
+// An outline style that isn't recognised, or isn't available, falls back to
+// "window".  That's reported once per setting of the option, rather than on
+// every drag.
+
+static void init_outline(struct outline *o) {
+	static const char *rejected = NULL;
+	*o = (struct outline){ .style = OUTLINE_WINDOW };
+	if (!option.outline || 0 == strcmp(option.outline, "window"))
+		return;
+#ifdef SHAPE_OUTLINE
+	if (0 == strcmp(option.outline, "shape") && display.have_shape) {
+		o->style = OUTLINE_SHAPE;
+		return;
+	}
+#endif
+#ifdef GC_INVERT
+	if (0 == strcmp(option.outline, "invert")) {
+		o->style = OUTLINE_INVERT;
+		return;
+	}
 #endif
+	if (rejected != option.outline) {
+		LOG_ERROR("outline style '%s' not available, using 'window'\n", option.outline);
+		rejected = option.outline;
+	}
+}
 
-static int absmin(int a, int b) {
-	if (abs(a) < abs(b))
-		return a;
-	return b;
+static void set_outline(struct outline *o, struct client *c) {
+	switch (o->style) {
+	case OUTLINE_WINDOW:
+		window_outline(c);
+		if (!o->shown) {
+			for (int i = 0; i < 4; i++)
+				XMapRaised(display.dpy, c->screen->outline[i]);
+		}
+		break;
+#ifdef SHAPE_OUTLINE
+	case OUTLINE_SHAPE:
+		do_outline(c, 1);
+		break;
+#endif
+#ifdef GC_INVERT
+	case OUTLINE_INVERT:
+		o->drawn = set_inverted(c, o->drawn);
+		break;
+#endif
+	default:
+		break;
+	}
+	o->shown = 1;
 }
+
+static void clear_outline(struct outline *o, struct client *c) {
+	if (!o->shown)
+		return;
+	switch (o->style) {
+	case OUTLINE_WINDOW:
+		for (int i = 0; i < 4; i++)
+			XUnmapWindow(display.dpy, c->screen->outline[i]);
+		break;
+#ifdef SHAPE_OUTLINE
+	case OUTLINE_SHAPE:
+		do_outline(c, 0);
+		break;
+#endif
+#ifdef GC_INVERT
+	case OUTLINE_INVERT:
+		clear_inverted(o->drawn);
+		o->drawn = NULL;
+		break;
+#endif
+	default:
+		break;
+	}
+	o->shown = 0;
+}
+
 static _Bool bound(int a, int b, int min, int max) {
 	return !( (a<min&&b<min) || (a>max&&b>max) );
 	// false only when
@@ -140,40 +251,124 @@ static _Bool bound(int a, int b, int min, int max) {
 	//        |------------------|   b a
 }
 
-// Snap a client to the edges of other clients (if on same screen, and visible)
-// or to the screen border.
-// Typically skipped when altmask is held (default shift)
+// Edges that a window being dragged or swept may snap to, sorted by position
+// so that each motion event need only look at those nearby.  Built at the
+// start of the interaction, as nothing else moves until it's over.
+
+struct snap_edge {
+	int pos;     // position to snap to
+	int lo, hi;  // perpendicular range within which the edge applies
+};
 
-static void snap_client(struct client *c, struct monitor *monitor) {
-	int dx, dy;
-	dx = dy = option.snap;
-	for (struct list *iter = &(struct list){ // insert monitor as client
-		.next=clients_tab_order,
-		.data=&(struct client){
+struct snap_index {
+	struct snap_edge *x, *y;
+	int nx, ny;
+};
+
+static int snap_edge_cmp(const void *a, const void *b) {
+	const struct snap_edge *ea = a, *eb = b;
+	return (ea->pos > eb->pos) - (ea->pos < eb->pos);
+}
+
+static void add_edge(struct snap_edge *e, int *n, int pos, int lo, int hi) {
+	e[*n] = (struct snap_edge){ .pos = pos, .lo = lo, .hi = hi };
+	(*n)++;
+}
+
+// Index the monitor and other visible clients on the same screen.  For a
+// drag, positions are those the client's own x or y would take to line up
+// its edges (inside or outside the border) with the other client's, and
+// apply while the client is within snap distance in the other axis.  For a
+// sweep, positions are the other client's edges, for the pointer to snap to.
+
+static void snap_index_build(struct snap_index *si, struct client *c,
+                             struct monitor *monitor, _Bool sweep) {
+	struct screen *s = c->screen;
+	unsigned n = 1;
+	for (struct client *ci = s->mapping.head; ci; ci = ci->mapping.next)
+		n++;
+	si->x = xmalloc(4 * n * sizeof(*si->x));
+	si->y = xmalloc(4 * n * sizeof(*si->y));
+	si->nx = si->ny = 0;
+
+	int snap = option.snap;
+	for (struct client *ci = &(struct client){ // insert monitor as client
 			.x=monitor->x+c->border,
 			.y=monitor->y+c->border,
 			.width=monitor->width-c->border*2,
 			.height=monitor->height-c->border*2,
-			.screen=c->screen,
+			.screen=s,
 			.vdesk=VDESK_FIXED,
-	0}}; iter; iter = iter->next) {
-		struct client *ci = iter->data;
+			.mapping.next=s->mapping.head,
+	}; ci; ci = ci->mapping.next) {
 		if (ci == c) continue;
-		if (ci->screen != c->screen) continue;
 		if (!is_visible(ci)) continue;
-		if (ci->y - ci->border - c->border - c->height - c->y <= option.snap && c->y - c->border - ci->border - ci->height - ci->y <= option.snap) {
-			dx = absmin(dx, ci->x + ci->width - c->x + c->border + ci->border);
-			dx = absmin(dx, ci->x + ci->width - c->x - c->width);
-			dx = absmin(dx, ci->x - c->x - c->width - c->border - ci->border);
-			dx = absmin(dx, ci->x - c->x);
+		if (sweep) {
+			add_edge(si->x, &si->nx, ci->x,              ci->y, ci->y + ci->height);
+			add_edge(si->x, &si->nx, ci->x + ci->width,  ci->y, ci->y + ci->height);
+			add_edge(si->y, &si->ny, ci->y,              ci->x, ci->x + ci->width);
+			add_edge(si->y, &si->ny, ci->y + ci->height, ci->x, ci->x + ci->width);
+			continue;
+		}
+		int bw = ci->border + c->border;
+		int ylo = ci->y - bw - c->height - snap;
+		int yhi = ci->y + ci->height + bw + snap;
+		add_edge(si->x, &si->nx, ci->x + ci->width + bw,          ylo, yhi);
+		add_edge(si->x, &si->nx, ci->x + ci->width - c->width,    ylo, yhi);
+		add_edge(si->x, &si->nx, ci->x - c->width - bw,           ylo, yhi);
+		add_edge(si->x, &si->nx, ci->x,                           ylo, yhi);
+		int xlo = ci->x - bw - c->width - snap;
+		int xhi = ci->x + ci->width + bw + snap;
+		add_edge(si->y, &si->ny, ci->y + ci->height + bw,         xlo, xhi);
+		add_edge(si->y, &si->ny, ci->y + ci->height - c->height,  xlo, xhi);
+		add_edge(si->y, &si->ny, ci->y - c->height - bw,          xlo, xhi);
+		add_edge(si->y, &si->ny, ci->y,                           xlo, xhi);
+	}
+	qsort(si->x, si->nx, sizeof(*si->x), snap_edge_cmp);
+	qsort(si->y, si->ny, sizeof(*si->y), snap_edge_cmp);
+}
+
+static void snap_index_free(struct snap_index *si) {
+	free(si->x);
+	free(si->y);
+}
+
+// Offset from pos to the nearest edge applying somewhere in [a,b], or the
+// snap distance if there's none closer.  Binary search, then scan outwards
+// only as far as could improve on the best found.
+
+static int snap_nearest(const struct snap_edge *e, int n, int pos, int a, int b) {
+	int lo = 0, hi = n;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (e[mid].pos < pos)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	int best = option.snap;
+	for (int i = lo; i < n && e[i].pos - pos < abs(best); i++) {
+		if (bound(a, b, e[i].lo, e[i].hi)) {
+			best = e[i].pos - pos;
+			break;
 		}
-		if (ci->x - ci->border - c->border - c->width - c->x <= option.snap && c->x - c->border - ci->border - ci->width - ci->x <= option.snap) {
-			dy = absmin(dy, ci->y + ci->height - c->y + c->border + ci->border);
-			dy = absmin(dy, ci->y + ci->height - c->y - c->height);
-			dy = absmin(dy, ci->y - c->y - c->height - c->border - ci->border);
-			dy = absmin(dy, ci->y - c->y);
+	}
+	for (int i = lo - 1; i >= 0 && pos - e[i].pos < abs(best); i--) {
+		if (bound(a, b, e[i].lo, e[i].hi)) {
+			best = e[i].pos - pos;
+			break;
 		}
 	}
+	return best;
+}
+
+// Snap a client to the edges of other clients (if on same screen, and visible)
+// or to the screen border.
+// Typically skipped when altmask is held (default shift)
+
+static void snap_client(struct client *c, const struct snap_index *si) {
+	int dx = snap_nearest(si->x, si->nx, c->x, c->y, c->y);
+	int dy = snap_nearest(si->y, si->ny, c->y, c->x, c->x);
 	if (abs(dx) < option.snap)
 		c->x += dx;
 	if (abs(dy) < option.snap)
@@ -183,34 +378,11 @@ static void snap_client(struct client *c, struct monitor *monitor) {
 // During a sweep (resize interaction), recalculate new dimensions for a window
 // based on mouse position relative to top-left corner.
 
-static void recalculate_sweep(struct client *c, int x1, int y1, int x2, int y2, _Bool force, struct monitor *monitor) {
+static void recalculate_sweep(struct client *c, int x1, int y1, int x2, int y2, _Bool force, const struct snap_index *si) {
 	if (!force && option.snap) {
 		// Snap cursor position to nearest border
-		int dx = option.snap;
-		int dy = option.snap;
-		for (struct list *iter = &(struct list){ // insert monitor as client
-			.next=clients_tab_order,
-			.data=&(struct client){
-				.x=monitor->x+c->border,
-				.y=monitor->y+c->border,
-				.width=monitor->width-c->border*2,
-				.height=monitor->height-c->border*2,
-				.screen=c->screen,
-				.vdesk=VDESK_FIXED,
-		0}}; iter; iter = iter->next) {
-			struct client *ci = iter->data;
-			if (ci == c) continue;
-			if (ci->screen != c->screen) continue;
-			if (!is_visible(ci)) continue;
-			if (bound(y1, y2, ci->y, ci->y+ci->height)) {
-				dx=absmin(dx, ci->x              - x2);
-				dx=absmin(dx, ci->x + ci->width  - x2);
-			}
-			if (bound(x1, x2, ci->x, ci->x+ci->width )) {
-				dy=absmin(dy, ci->y              - y2);
-				dy=absmin(dy, ci->y + ci->height - y2);
-			}
-		}
+		int dx = snap_nearest(si->x, si->nx, x2, y1, y2);
+		int dy = snap_nearest(si->y, si->ny, y2, x1, x2);
 		if (abs(dx) < option.snap) x2 += dx;
 		if (abs(dy) < option.snap) y2 += dy;
 	}
@@ -236,9 +408,9 @@ static void recalculate_sweep(struct client *c, int x1, int y1, int x2, int y2,
 }
 
 #ifndef INFOBANNER_MOVERESIZE
-# define create_info_window(...)
-# define update_info_window(...)
-# define remove_info_window(...)
+# define create_info_window(...) do {} while (0)
+# define update_info_window(...) do {} while (0)
+# define remove_info_window(...) do {} while (0)
 #endif
 
 static int motion_predicate(Display *d, XEvent *ev, XPointer arg){
@@ -249,6 +421,234 @@ static int motion_predicate(Display *d, XEvent *ev, XPointer arg){
 	return 0;
 }
 
+// Pointer events, plus SYNC alarms that may release a held frame
+static Bool pointer_predicate(Display *d, XEvent *ev, XPointer arg) {
+	(void)d;
+	(void)arg;
+	switch (ev->type) {
+	case ButtonPress: case ButtonRelease: case MotionNotify:
+		return True;
+	default:
+		break;
+	}
+#ifdef XSYNC
+	if (display.have_sync && ev->type == display.sync_event_base + XSyncAlarmNotify)
+		return True;
+#endif
+	return False;
+}
+
+// Frame pacing for drags & sweeps.  With a nonzero "framerate" option,
+// pointer motion only updates the client's geometry, which is then shown at
+// most once per frame.  However fast motion arrives, clients see a bounded
+// rate of configure requests.  Motion after an idle spell is shown at once.
+// With no frame rate, geometry is shown for each motion event unless another
+// is already queued.
+//
+// Frames may also be held until a client catches up.  A client listing
+// _NET_WM_SYNC_REQUEST in WM_PROTOCOLS provides a counter, which we ask it to
+// set to a new value once it has handled a configure.  During solid sweeps,
+// no further resize is sent until it does, or until SYNC_TIMEOUT_NS passes,
+// after which we stop waiting on it.
+
+#define SYNC_TIMEOUT_NS 250000000
+
+struct pacer {
+	uint64_t interval;  // nanoseconds between frames; 0 if not paced
+	uint64_t next;      // earliest time next frame may be shown
+	uint64_t hold;      // if nonzero, awaiting client until this time
+	_Bool pending;      // geometry changed since last shown
+#ifdef XSYNC
+	XSyncCounter counter;
+	XSyncAlarm alarm;   // None unless syncing with client
+	uint64_t value;     // counter value last requested
+#endif
+};
+
+static void init_pacer(struct pacer *p) {
+	*p = (struct pacer){0};
+	if (option.framerate > 0)
+		p->interval = 1000000000 / option.framerate;
+#ifdef XSYNC
+	p->counter = None;
+	p->alarm = None;
+#endif
+}
+
+#ifdef XSYNC
+// Find the client's sync counter and set an alarm to notify us when it
+// reaches the value last requested.
+
+static void pacer_sync_init(struct pacer *p, struct client *c) {
+	Atom *protocols;
+	int n, found = 0;
+	if (!display.have_sync)
+		return;
+	if (XGetWMProtocols(display.dpy, c->window, &protocols, &n)) {
+		for (int i = 0; i < n; i++) {
+			if (protocols[i] == X_ATOM(_NET_WM_SYNC_REQUEST))
+				found = 1;
+		}
+		XFree(protocols);
+	}
+	if (!found)
+		return;
+
+	unsigned long nitems;
+	unsigned long *counter = get_property(c->window, X_ATOM(_NET_WM_SYNC_REQUEST_COUNTER),
+	                                      XA_CARDINAL, &nitems);
+	if (!counter)
+		return;
+	if (nitems >= 1)
+		p->counter = counter[0];
+	XFree(counter);
+
+	XSyncValue value;
+	if (p->counter == None || !XSyncQueryCounter(display.dpy, p->counter, &value)) {
+		p->counter = None;
+		return;
+	}
+	p->value = ((uint64_t)(uint32_t)XSyncValueHigh32(value) << 32) | XSyncValueLow32(value);
+
+	XSyncAlarmAttributes aa;
+	aa.trigger.counter = p->counter;
+	aa.trigger.value_type = XSyncAbsolute;
+	aa.trigger.wait_value = value;
+	aa.trigger.test_type = XSyncPositiveComparison;
+	XSyncIntToValue(&aa.delta, 1);
+	aa.events = True;
+	p->alarm = XSyncCreateAlarm(display.dpy, XSyncCACounter | XSyncCAValueType
+	                            | XSyncCAValue | XSyncCATestType | XSyncCADelta
+	                            | XSyncCAEvents, &aa);
+	LOG_DEBUG("syncing with client %lx using counter %lx\n",
+	          (unsigned long)c->window, (unsigned long)p->counter);
+}
+
+static void pacer_sync_free(struct pacer *p) {
+	if (p->alarm != None)
+		XSyncDestroyAlarm(display.dpy, p->alarm);
+	p->alarm = None;
+	p->hold = 0;
+}
+
+// Send _NET_WM_SYNC_REQUEST ahead of a configure, and hold frames until the
+// client acknowledges it.
+
+static void pacer_sync_request(struct pacer *p, struct client *c) {
+	p->value++;
+	XEvent ev = { .xclient = {
+		.type = ClientMessage,
+		.window = c->window,
+		.message_type = X_ATOM(WM_PROTOCOLS),
+		.format = 32,
+		.data.l = {
+			X_ATOM(_NET_WM_SYNC_REQUEST), CurrentTime,
+			(long)(p->value & 0xffffffff), (long)(p->value >> 32), 0
+		}
+	} };
+	XSendEvent(display.dpy, c->window, False, NoEventMask, &ev);
+
+	XSyncAlarmAttributes aa;
+	XSyncIntsToValue(&aa.trigger.wait_value, p->value & 0xffffffff, p->value >> 32);
+	XSyncChangeAlarm(display.dpy, p->alarm, XSyncCAValue, &aa);
+	p->hold = monotonic_ns() + SYNC_TIMEOUT_NS;
+}
+
+static _Bool pacer_sync_acked(struct pacer *p, XEvent *ev) {
+	if (!display.have_sync || ev->type != display.sync_event_base + XSyncAlarmNotify)
+		return 0;
+	XSyncAlarmNotifyEvent *aev = (XSyncAlarmNotifyEvent *)ev;
+	if (p->alarm == None || aev->alarm != p->alarm)
+		return 0;
+	uint64_t value = ((uint64_t)(uint32_t)XSyncValueHigh32(aev->counter_value) << 32)
+	                 | XSyncValueLow32(aev->counter_value);
+	return value >= p->value;
+}
+#endif
+
+// Wait for the next pointer event.  Returns zero instead when a pending
+// frame is due to be shown.
+
+static int pacer_next_event(struct pacer *p, XEvent *ev) {
+	for (;;) {
+		if (!p->pending) {
+			XIfEvent(display.dpy, ev, pointer_predicate, NULL);
+		} else {
+			uint64_t deadline = p->next > p->hold ? p->next : p->hold;
+			if (!timedXIfEvent(ev, pointer_predicate, NULL, deadline))
+				return 0;
+		}
+#ifdef XSYNC
+		if (pacer_sync_acked(p, ev)) {
+			p->hold = 0;
+			continue;
+		}
+#endif
+		if (ev->type == ButtonPress || ev->type == ButtonRelease
+		    || ev->type == MotionNotify)
+			return 1;
+	}
+}
+
+// Call when geometry changes.  Returns true if it should be shown now,
+// otherwise that will be signalled by pacer_next_event().
+
+static _Bool pacer_motion(struct pacer *p) {
+	uint64_t now = monotonic_ns();
+	if (now < p->hold || (p->interval && now < p->next)) {
+		p->pending = 1;
+		return 0;
+	}
+	if (!p->interval) {
+		XEvent evc;
+		return !XCheckIfEvent(display.dpy, &evc, motion_predicate, NULL);
+	}
+	return 1;
+}
+
+static void pacer_shown(struct pacer *p) {
+	p->next = monotonic_ns() + p->interval;
+	p->pending = 0;
+}
+
+static void show_sweep(struct client *c, struct outline *outline, struct pacer *pacer) {
+	if (option.solid_sweep) {
+#ifdef XSYNC
+		if (pacer->alarm != None) {
+			if (pacer->hold) {
+				// Timed out waiting for client
+				LOG_DEBUG("client %lx not syncing\n", (unsigned long)c->window);
+				pacer_sync_free(pacer);
+			} else {
+				pacer_sync_request(pacer, c);
+			}
+		}
+#endif
+		client_moveresize(c);
+	} else {
+		set_outline(outline, c);
+	}
+	update_info_window(c);
+	pacer_shown(pacer);
+}
+
+static void show_drag(struct client *c, struct outline *outline, struct pacer *pacer) {
+	update_info_window(c);
+	if (option.solid_drag) {
+		XMoveWindow(display.dpy, c->parent,
+				c->x - c->border,
+				c->y - c->border);
+		send_config(c);
+	} else if (outline->style == OUTLINE_SHAPE) {
+		XMoveWindow(display.dpy, c->parent,
+				c->x - c->border,
+				c->y - c->border);
+	} else {
+		set_outline(outline, c);
+	}
+	pacer_shown(pacer);
+}
+
 #ifndef MOVERESIZE_RAISE
 #define client_moveresizeraise(...) client_moveresize(__VA_ARGS__)
 #endif
@@ -259,20 +659,25 @@ void client_resize_sweep(struct client *c, unsigned button) {
 	if (!grab_pointer(c->screen->root, display.resize_curs))
 		return;
 
-	// Sweeping always raises.
+	// Sweeping always raises.  Restack now, as the main loop won't get
+	// a chance to until the sweep is over.
 #ifdef MOVERESIZE_RAISE
 	client_raise(c);
+	client_commit_stacking();
 #endif
 
 	int old_cx = c->x;
 	int old_cy = c->y;
 
 	struct monitor *monitor = client_monitor(c, NULL);
+	struct snap_index si;
+	snap_index_build(&si, c, monitor, 1);
 
 	create_info_window(c);
-	init_outline(c);
+	struct outline outline;
+	init_outline(&outline);
 	if (!option.solid_sweep)
-		set_outline(c);
+		set_outline(&outline, c);
 #ifdef RESIZE_WARP_POINTER
 	// Warp pointer to the bottom-right of the client for resizing
 	setmouse(c->window, c->width, c->height);
@@ -280,39 +685,46 @@ void client_resize_sweep(struct client *c, unsigned button) {
 	// do initial resize to pointer
 #endif
 
+	struct pacer pacer;
+	init_pacer(&pacer);
+#ifdef XSYNC
+	if (option.solid_sweep)
+		pacer_sync_init(&pacer, c);
+#endif
 	for (;;) {
 		XEvent ev;
-		XMaskEvent(display.dpy, ButtonPressMask|ButtonReleaseMask|PointerMotionMask, &ev);
+		if (!pacer_next_event(&pacer, &ev)) {
+			show_sweep(c, &outline, &pacer);
+			continue;
+		}
 		switch (ev.type) {
 			case MotionNotify:
 				if (ev.xmotion.root != c->screen->root)
 					break;
-				XUngrabServer(display.dpy);// outline
-				recalculate_sweep(c, old_cx, old_cy, ev.xmotion.x, ev.xmotion.y, ev.xmotion.state & altmask, monitor);
-
-				XEvent evc;
-				if (!XCheckIfEvent(display.dpy,&evc,motion_predicate,NULL)) {
-					if (option.solid_sweep)
-						client_moveresize(c);
-					else
-						set_outline(c);
-				}
+				recalculate_sweep(c, old_cx, old_cy, ev.xmotion.x, ev.xmotion.y, ev.xmotion.state & altmask, &si);
 
-				update_info_window(c);
+				if (pacer_motion(&pacer))
+					show_sweep(c, &outline, &pacer);
+				else
+					update_info_window(c);
 				break;
 
 			case ButtonRelease:
 				if (ev.xbutton.button != button)
 					break;
 				if (!option.solid_sweep)
-					clear_outline(c);
+					clear_outline(&outline, c);
 				remove_info_window();
 				XUngrabPointer(display.dpy, CurrentTime);
 
-				recalculate_sweep(c, old_cx, old_cy, ev.xmotion.x, ev.xmotion.y, ev.xmotion.state & altmask, monitor);
+				recalculate_sweep(c, old_cx, old_cy, ev.xmotion.x, ev.xmotion.y, ev.xmotion.state & altmask, &si);
 				client_moveresizeraise(c);
 				// In case maximise state has changed:
-				ewmh_set_net_wm_state(c);
+				client_dirty(c, CLIENT_DIRTY_NET_WM_STATE);
+				snap_index_free(&si);
+#ifdef XSYNC
+				pacer_sync_free(&pacer);
+#endif
 				return;
 
 			default:
@@ -333,8 +745,10 @@ void client_move_drag(struct client *c, unsigned button) {
 		return;
 
 #ifdef MOVERESIZE_RAISE
-	// Dragging always raises.
+	// Dragging always raises.  Restack now, as the main loop won't get
+	// a chance to until the drag is over.
 	client_raise(c);
+	client_commit_stacking();
 #endif
 
 	// Initial pointer and window positions; new coordinates calculated
@@ -345,19 +759,27 @@ void client_move_drag(struct client *c, unsigned button) {
 	get_pointer_root_xy(c->screen->root, &x1, &y1);
 
 	struct monitor *monitor = client_monitor(c, NULL);
+	struct snap_index si;
+	snap_index_build(&si, c, monitor, 0);
 
 	create_info_window(c);
-	init_outline(c);
+	struct outline outline;
+	init_outline(&outline);
 	if (!option.solid_drag) {
-		set_outline(c);
+		set_outline(&outline, c);
 	}
 
 #ifndef MOVERESIZE_RAISE
 	int moved = 0;
 #endif
+	struct pacer pacer;
+	init_pacer(&pacer);
 	for (;;) {
 		XEvent ev;
-		XMaskEvent(display.dpy, ButtonPressMask|ButtonReleaseMask|PointerMotionMask, &ev);
+		if (!pacer_next_event(&pacer, &ev)) {
+			show_drag(c, &outline, &pacer);
+			continue;
+		}
 		switch (ev.type) {
 			case MotionNotify:
 				if (ev.xmotion.root != c->screen->root)
@@ -368,33 +790,19 @@ void client_move_drag(struct client *c, unsigned button) {
 				c->x = old_cx + (ev.xmotion.x - x1);
 				c->y = old_cy + (ev.xmotion.y - y1);
 				if (option.snap && !(ev.xmotion.state & altmask))
-					snap_client(c, monitor);
+					snap_client(c, &si);
 
-				XEvent evc;
-				if (!XCheckIfEvent(display.dpy,&evc,motion_predicate,NULL)) {
-					update_info_window(c);
-					if (option.solid_drag) {
-						XMoveWindow(display.dpy, c->parent,
-								c->x - c->border,
-								c->y - c->border);
-						send_config(c);
-					} else {
-#ifdef SHAPE_OUTLINE
-						XMoveWindow(display.dpy, c->parent,
-								c->x - c->border,
-								c->y - c->border);
-#else
-						set_outline(c);
-#endif
-					}
-				}
+				if (pacer_motion(&pacer))
+					show_drag(c, &outline, &pacer);
 				break;
 
 			case ButtonRelease:
 				if (ev.xbutton.button != button)
 					continue;
 				if (!option.solid_drag) {
-					clear_outline(c);
+					clear_outline(&outline, c);
+				} else if (pacer.pending) {
+					show_drag(c, &outline, &pacer);
 				}
 				remove_info_window();
 				XUngrabPointer(display.dpy, CurrentTime);
@@ -407,6 +815,7 @@ void client_move_drag(struct client *c, unsigned button) {
 #ifndef MOVERESIZE_RAISE
 				if (!moved)  client_raise(c);
 #endif
+				snap_index_free(&si);
 				return;
 
 			default:
@@ -461,8 +870,9 @@ void client_show_info(struct client *c, XEvent *e) {
 #ifdef INFOBANNER
 	create_info_window(c);
 #else
-	init_outline(c);
-	set_outline(c);
+	struct outline outline;
+	init_outline(&outline);
+	set_outline(&outline, c);
 #endif
 
 	for (;;) {
@@ -486,7 +896,7 @@ void client_show_info(struct client *c, XEvent *e) {
 #ifdef INFOBANNER
 	remove_info_window();
 #else
-	clear_outline(c, outline_c);
+	clear_outline(&outline, c);
 #endif
 
 	if (e->type == KeyPress) {
@@ -610,7 +1020,7 @@ void client_maximise(struct client *c, int action, int hv) {
 		XSetWindowBorderWidth(display.dpy, c->parent, c->border);
 		ewmh_set_net_frame_extents(c->window, c->border);
 	}
-	ewmh_set_net_wm_state(c);
+	client_dirty(c, CLIENT_DIRTY_NET_WM_STATE);
 	client_moveresizeraise(c);
 #ifdef MAXIMIZE_DISCARDENTERS
 	discard_enter_events(c);
@@ -621,18 +1031,17 @@ void client_maximise(struct client *c, int action, int hv) {
 // (basically, handle Alt+Tab).  Order is most-recently-used (maintained in the
 // clients_tab_order list).
 
-static struct client *next_visible_client(struct list *order) {
-	if (!order) return NULL;
-	for (struct list *l = order->next/*note the next*/; l; l=l->next) {
-		if (is_visible((struct client *)l->data)) return l->data;
+static struct client *next_visible_client(struct client *c) {
+	for (; c; c = c->tab.next) {
+		if (is_visible(c)) return c;
 	}
 	return NULL;
 }
 
 void client_select_next(void) {
-	if (!clients_tab_order) return;
-	struct client *c = next_visible_client(list_find(clients_tab_order, current));
-	if (!c) c = next_visible_client(&(struct list){.next=clients_tab_order});
+	if (!clients_tab_order.head) return;
+	struct client *c = current ? next_visible_client(current->tab.next) : NULL;
+	if (!c) c = next_visible_client(clients_tab_order.head);
 	if (!c) return;
 	client_intersect(c);
 	client_moveresize(c);
@@ -647,7 +1056,3 @@ void client_select_next(void) {
 	discard_enter_events(c);
 #endif
 }
-
-#undef init_outline
-#undef clear_outline
-#undef set_outline
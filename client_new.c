@@ -29,50 +29,55 @@
 #include "list.h"
 #include "log.h"
 #include "screen.h"
+#include "termpool.h"
 #include "util.h"
+#include "winprops.h"
 
-static void init_geometry(struct client *c);
+static void manage_new(struct winprops *wp, struct screen *s);
+static void init_geometry(struct client *c, struct winprops *wp);
 static void reparent(struct client *c);
 
 // client_manage_new is called when a map request event for an unmanaged window
-// is handled, and on startup for all windows found.
+// is handled, and on startup for all windows found.  The caller will already
+// have fetched the window's attributes and properties into wp.
+//
+// The window may be destroyed at any point, so any errors raised while
+// managing it are ignored: if it's gone, its DestroyNotify will follow.
+
+void client_manage_new(struct winprops *wp, struct screen *s) {
+	xerror_ignore_begin(wp->w);
+	manage_new(wp, s);
+	xerror_ignore_end();
+}
 
-void client_manage_new(Window w, struct screen *s) {
+static void manage_new(struct winprops *wp, struct screen *s) {
+	Window w = wp->w;
 	struct client *c;
-	char *name;
-	XClassHint *class;
+	const char *name;
+	const char *res_name, *res_class;
 	unsigned window_type;
+	unsigned long nitems;
 
 	LOG_ENTER("client_manage_new(window=%lx)", (unsigned long)w);
 
-	// First a bit of interaction with the error handler due to X's
-	// tendency to batch event notifications.  We set a global variable to
-	// the id of the window we're initialising then do simple X call on
-	// that window.  If an error is raised by this (and nothing else should
-	// do so as we've grabbed the server), the error handler resets the
-	// variable indicating the window has already disappeared, so we stop
-	// trying to manage it.
-
-	initialising = w;
-	XTextProperty wmname;
-	XGetWMName(display.dpy, w, &wmname);
-	name = (char *)wmname.value;
+	// If fetching the window's attributes failed, the window has been
+	// removed before we got a chance to manage it.
 
-	// If 'initialising' is now set to None, that means doing the
-	// XGetWMName raised BadWindow - the window has been removed before
-	// we got a chance to grab the server. */
-
-	if (initialising == None) {
+	if (!(wp->valid & WINPROPS_ATTR) || !s) {
 		LOG_DEBUG("XError occurred for initialising window - aborting...\n");
 		LOG_LEAVE();
 		return;
 	}
 
-	window_type = ewmh_get_net_wm_window_type(w);
+	name = (wp->prop[WINPROP_WM_NAME].format == 8) ? wp->prop[WINPROP_WM_NAME].data : NULL;
+
+	Atom *aprop = winprops_get(wp, WINPROP_NET_WM_WINDOW_TYPE, XA_ATOM, &nitems);
+	window_type = aprop ? ewmh_parse_net_wm_window_type(aprop, nitems) : 0;
 	// Don't manage DESKTOP type windows
 	if (window_type & EWMH_WINDOW_TYPE_DESKTOP) {
 		LOG_DEBUG("EWMH_WINDOW_TYPE_DESKTOP\n");
 		XMapWindow(display.dpy, w);
+		screen_add_desktop(s, w);
 		LOG_LEAVE();
 		return;
 	}
@@ -86,19 +91,19 @@ void client_manage_new(Window w, struct screen *s) {
 		LOG_LEAVE();
 		return;
 	}
-	clients_tab_order = list_prepend(clients_tab_order, c);
-	clients_mapping_order = list_append(clients_mapping_order, c);
-	clients_stacking_order = list_append(clients_stacking_order, c);
-
 	*c=(struct client){0};
+	dlist_prepend(&clients_tab_order, c);
+	dlist_append(&s->mapping, c);
+	dlist_append(&s->stacking, c);
 	c->screen = s;
 	c->window = w;
+	client_index_insert(c);
 	update_window_type_flags(c, window_type);
-	init_geometry(c);
+	init_geometry(c, wp);
 
 #ifdef DEBUG
 	{
-		int i = 0; for (struct list *iter = clients_tab_order; iter; iter = iter->next) i++;
+		int i = 0; for (struct client *iter = clients_tab_order.head; iter; iter = iter->tab.next) i++;
 		LOG_DEBUG("new window %dx%d+%d+%d, wincount=%d\n", c->width, c->height, c->x, c->y, i);
 	}
 #endif
@@ -106,6 +111,7 @@ void client_manage_new(Window w, struct screen *s) {
 	XSelectInput(display.dpy, c->window, ColormapChangeMask | EnterWindowMask | PropertyChangeMask);
 
 	reparent(c);
+	client_index_insert(c);
 
 #ifdef SHAPE
 	if (display.have_shape) {
@@ -116,63 +122,58 @@ void client_manage_new(Window w, struct screen *s) {
 
 	// Read name/class information for client and check against list built
 	// with -app options.
-	class = XAllocClassHint();
-	if (class) {
-		XGetClassHint(display.dpy, w, class);
-		LOG_DEBUG("app %s/%s/%s\n",class->res_name,class->res_class,name);
-		for (struct list *iter = applications; iter; iter = iter->next) {
-			struct application *a = iter->data;
-			// match if either the parameter
-			//  doesn't exist,
-			//  is NULL & an empty string respectively (eg matching a null/null window with '/'), or 
-			//  the strings are the same (or in name's case, a substring)
-			if ((!a->res_name  || (!class->res_name  && !*a->res_name ) || (class->res_name  && !strcmp(class->res_name,  a->res_name )))
-			 && (!a->res_class || (!class->res_class && !*a->res_class) || (class->res_class && !strcmp(class->res_class, a->res_class)))
-			 && (!a->WM_NAME   || (!name             && !*a->WM_NAME  ) || (name             &&  strstr(name,             a->WM_NAME  )))) {
-				LOG_DEBUG("matching %s/%s/%s, using app settings\n",a->res_name,a->res_class,a->WM_NAME);
-				// Override width or height?
-				if (a->geometry_mask & WidthValue)
-					c->width = a->width * c->width_inc;
-				if (a->geometry_mask & HeightValue)
-					c->height = a->height * c->height_inc;
-
-				// Override X or Y?
-				if (a->geometry_mask & XValue) {
-					if (a->geometry_mask & XNegative)
-						c->x = a->x + DisplayWidth(display.dpy, s->screen)-c->width-c->border;
-					else
-						c->x = a->x + c->border;
-				}
-				if (a->geometry_mask & YValue) {
-					if (a->geometry_mask & YNegative)
-						c->y = a->y + DisplayHeight(display.dpy, s->screen)-c->height-c->border;
-					else
-						c->y = a->y + c->border;
-				}
-
-				client_moveresize(c);
+	winprops_get_class_hint(wp, &res_name, &res_class);
+	LOG_DEBUG("app %s/%s/%s\n",res_name,res_class,name);
+	for (struct list *iter = applications; iter; iter = iter->next) {
+		struct application *a = iter->data;
+		// match if either the parameter
+		//  doesn't exist,
+		//  is NULL & an empty string respectively (eg matching a null/null window with '/'), or 
+		//  the strings are the same (or in name's case, a substring)
+		if ((!a->res_name  || (!res_name  && !*a->res_name ) || (res_name  && !strcmp(res_name,  a->res_name )))
+		 && (!a->res_class || (!res_class && !*a->res_class) || (res_class && !strcmp(res_class, a->res_class)))
+		 && (!a->WM_NAME   || (!name      && !*a->WM_NAME  ) || (name      &&  strstr(name,      a->WM_NAME  )))) {
+			LOG_DEBUG("matching %s/%s/%s, using app settings\n",a->res_name,a->res_class,a->WM_NAME);
+			// Override width or height?
+			if (a->geometry_mask & WidthValue)
+				c->width = a->width * c->width_inc;
+			if (a->geometry_mask & HeightValue)
+				c->height = a->height * c->height_inc;
+
+			// Override X or Y?
+			if (a->geometry_mask & XValue) {
+				if (a->geometry_mask & XNegative)
+					c->x = a->x + DisplayWidth(display.dpy, s->screen)-c->width-c->border;
+				else
+					c->x = a->x + c->border;
+			}
+			if (a->geometry_mask & YValue) {
+				if (a->geometry_mask & YNegative)
+					c->y = a->y + DisplayHeight(display.dpy, s->screen)-c->height-c->border;
+				else
+					c->y = a->y + c->border;
+			}
+
+			client_moveresize(c);
 
 #ifdef CONFIGREQ
-				// Force this app to only be move/resized by user?
-				if (a->ignore_configreq)
-					c->ignore_configreq = 1;
+			// Force this app to only be move/resized by user?
+			if (a->ignore_configreq)
+				c->ignore_configreq = 1;
 #endif
 
-				// Force treating this app as a dock?
-				if (a->is_dock)
-					c->is_dock = 1;
+			// Force treating this app as a dock?
+			if (a->is_dock)
+				c->is_dock = 1;
 
-				// Force app to specific vdesk?
-				if (a->vdesk != VDESK_NONE)
-					c->vdesk = a->vdesk;
-			}
+			// Force app to specific vdesk?
+			if (a->vdesk != VDESK_NONE)
+				c->vdesk = a->vdesk;
 		}
-		XFree(class->res_name);
-		XFree(class->res_class);
-		XFree(class);
 	}
-	if (name)
-		XFree(name);
+
+	// A terminal we started for the pool stays hidden until wanted
+	termpool_adopt(c, wp);
 
 	LOG_DEBUG("%s","");
 	LOG_DEBUG_("vdesk %u, ", c->vdesk);
@@ -185,19 +186,26 @@ void client_manage_new(Window w, struct screen *s) {
 	// Set EWMH property on client advertising WM features
 	ewmh_set_allowed_actions(c);
 
-	// Update EWMH client list hints for screen
-	ewmh_set_net_client_list(c->screen);
-	ewmh_set_net_client_list_stacking(c->screen);
+	// Add to EWMH client list hints for screen (pooled terminals aren't
+	// listed until used)
+	if (c->vdesk != VDESK_POOL)
+		ewmh_client_list_add(c);
+	c->screen->dirty |= SCREEN_DIRTY_CLIENT_LIST_STACKING;
+
+	// Move frame into any vdesk container now its vdesk is known
+	client_update_container(c);
 
 	// Only map the window frame (and thus the window) if it's supposed
 	// to be visible on this virtual desktop.  Otherwise, set it to
 	// IconicState (hidden).
 	if (is_visible(c)) {
 		client_show(c);
+		LOG_TRACE("map_to_show window=0x%lx us=%.1f\n", (unsigned long)w,
+		          (monotonic_ns() - wp->trace_time) / 1e3);
 		// Don't focus windows that aren't on the same display as the
 		// pointer.
 #if defined(NEWCLIENT_SELECT) || defined(WARP_POINTER) || defined(NEWCLIENT_DISCARDENTERS)
-		if (get_pointer_root_xy(c->window, NULL, NULL) &&
+		if (winprops_get_pointer_root_xy(wp, NULL, NULL) &&
 		    !(window_type & (EWMH_WINDOW_TYPE_DOCK|EWMH_WINDOW_TYPE_NOTIFICATION))) {
 #ifdef NEWCLIENT_SELECT
 			client_select(c);
@@ -223,30 +231,25 @@ void client_manage_new(Window w, struct screen *s) {
 
 // Fetches various hints to determine a window's initial geometry.
 
-static void init_geometry(struct client *c) {
+static void init_geometry(struct client *c, struct winprops *wp) {
 	unsigned long nitems;
-	XWindowAttributes attr;
+	XWindowAttributes attr = wp->attr;
 
 	// Normal border size from MWM hints
-	c->normal_border = window_normal_border(c->window);
+	PropMwmHints *mprop = winprops_get(wp, WINPROP_MOTIF_WM_HINTS, X_ATOM(_MOTIF_WM_HINTS), &nitems);
+	c->normal_border = mprop ? mwm_hints_normal_border(mprop, nitems) : option.bw;
 
 	// Possible get a value for initial virtual desktop from EWMH hint
 	unsigned long *lprop;
 	c->vdesk = c->screen->vdesk;
-	if ( (lprop = get_property(c->window, X_ATOM(_NET_WM_DESKTOP), XA_CARDINAL, &nitems)) ) {
+	if ( (lprop = winprops_get(wp, WINPROP_NET_WM_DESKTOP, XA_CARDINAL, &nitems)) ) {
 		// NB, Xlib not only returns a 32bit value in a long (which may
 		// not be 32bits), it also sign extends the 32bit value
 		if (nitems && valid_vdesk(lprop[0] & UINT32_MAX)) {
 			c->vdesk = lprop[0] & UINT32_MAX;
 		}
-		XFree(lprop);
 	}
 
-	// Get current window attributes
-	LOG_XENTER("XGetWindowAttributes(window=%lx)", (unsigned long)c->window);
-	XGetWindowAttributes(display.dpy, c->window, &attr);
-	debug_window_attributes(&attr);
-	LOG_XLEAVE();
 	// We remove any client border, so preserve its old value to restore on
 	// emulator quit.
 	c->old_border = attr.border_width;
@@ -261,22 +264,20 @@ static void init_geometry(struct client *c) {
 	// coordinate and width.  These are unrepresented in EWMH hints, so
 	// would otherwise not survive window manager restart.
 	unsigned long *eprop;
-	if ( (eprop = get_property(c->window, X_ATOM(_EVILWM_UNMAXIMISED_HORZ), XA_CARDINAL, &nitems)) ) {
+	if ( (eprop = winprops_get(wp, WINPROP_EVILWM_UNMAXIMISED_HORZ, XA_CARDINAL, &nitems)) ) {
 		if (nitems == 2) {
 			c->oldx = eprop[0];
 			c->oldw = eprop[1];
 		}
-		XFree(eprop);
 	}
 
 	// Similarly _EVILWM_UNMAXIMISED_VERT will contain the unmaximised Y
 	// coordinate and height.
-	if ( (eprop = get_property(c->window, X_ATOM(_EVILWM_UNMAXIMISED_VERT), XA_CARDINAL, &nitems)) ) {
+	if ( (eprop = winprops_get(wp, WINPROP_EVILWM_UNMAXIMISED_VERT, XA_CARDINAL, &nitems)) ) {
 		if (nitems == 2) {
 			c->oldy = eprop[0];
 			c->oldh = eprop[1];
 		}
-		XFree(eprop);
 	}
 
 	c->border = (c->oldw && c->oldh) ? 0 : c->normal_border;
@@ -284,7 +285,10 @@ static void init_geometry(struct client *c) {
 	// Update some client info from the WM_NORMAL_HINTS property.  The
 	// flags returned will indicate whether certain values were user- or
 	// program-specified.
-	long size_flags = get_wm_normal_hints(c);
+	XSizeHints size = { 0 };
+	if (winprops_get_wm_normal_hints(wp, &size))
+		debug_wm_normal_hints(&size);
+	long size_flags = set_wm_normal_hints(c, &size);
 
 	_Bool need_send_config = 0;
 
@@ -311,12 +315,9 @@ static void init_geometry(struct client *c) {
 		c->x = attr.x;
 		c->y = attr.y;
 	} else {
-		int xmax = DisplayWidth(display.dpy, c->screen->screen);
-		int ymax = DisplayHeight(display.dpy, c->screen->screen);
 		int x, y;
-		get_pointer_root_xy(c->screen->root, &x, &y);
-		c->x = (x * (xmax - c->border - c->width)) / xmax;
-		c->y = (y * (ymax - c->border - c->height)) / ymax;
+		winprops_get_pointer_root_xy(wp, &x, &y);
+		client_place_at_pointer(c, x, y);
 		need_send_config = 1;
 	}
 
@@ -332,7 +333,24 @@ static void init_geometry(struct client *c) {
 		c->ignore_unmap++;
 	}
 
-	// Account for removed old_border
+	client_replace_border(c);
+}
+
+// Position a new window according to where the pointer is: as far across
+// the screen as the pointer is.  This is the window's own position, so
+// client_replace_border() must be applied afterwards.
+
+void client_place_at_pointer(struct client *c, int x, int y) {
+	int xmax = DisplayWidth(display.dpy, c->screen->screen);
+	int ymax = DisplayHeight(display.dpy, c->screen->screen);
+	c->x = (x * (xmax - c->border - c->width)) / xmax;
+	c->y = (y * (ymax - c->border - c->height)) / ymax;
+}
+
+// Adjust a window's position to account for its own border being removed
+// and the frame's added.
+
+void client_replace_border(struct client *c) {
 	c->x += c->old_border;
 	c->y += c->old_border;
 	client_gravitate(c, -c->old_border);
@@ -358,6 +376,7 @@ static void reparent(struct client *c) {
 		DefaultDepth(display.dpy, c->screen->screen), CopyFromParent,
 		DefaultVisual(display.dpy, c->screen->screen),
 		CWOverrideRedirect | CWBorderPixel | CWEventMask, &p_attr);
+	c->container = c->screen->root;
 
 	// Adding the original window to our "save set" means that if we die
 	// unexpectedly, the window will be reparented back to the root.
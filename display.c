@@ -25,6 +25,9 @@
 #ifdef RANDR
 #include <X11/extensions/Xrandr.h>
 #endif
+#ifdef XSYNC
+#include <X11/extensions/sync.h>
+#endif
 
 #include "client.h"
 #include "display.h"
@@ -32,8 +35,10 @@
 #include "ewmh.h"
 #include "list.h"
 #include "log.h"
+#include "loop.h"
 #include "screen.h"
 #include "util.h"
+#include "winprops.h"
 #include "xalloc.h"
 
 // evilwm only supports one display at a time; this variable is global:
@@ -95,6 +100,10 @@ static const char *atom_list[] = {
 	"_NET_WM_ACTION_CLOSE",
 	"_NET_WM_PID",
 	"_NET_FRAME_EXTENTS",
+
+	// EWMH: Window Manager Protocols
+	"_NET_WM_SYNC_REQUEST",
+	"_NET_WM_SYNC_REQUEST_COUNTER",
 };
 
 // Open and initialise display.  Exits the process on failure.
@@ -112,6 +121,9 @@ void display_open(void) {
 
 	XSetErrorHandler(handle_xerror);
 
+	// Main loop returns to read events when the connection has input
+	loop_watch_fd(ConnectionNumber(display.dpy), NULL, NULL);
+
 	// While debugging, synchronous behaviour may be desirable:
 	//XSynchronize(display.dpy, True);
 
@@ -188,6 +200,18 @@ void display_open(void) {
 	}
 #endif
 
+	// SYNC extension?
+#ifdef XSYNC
+	{
+		int e_dummy, major, minor;
+		display.have_sync = XSyncQueryExtension(display.dpy, &display.sync_event_base, &e_dummy)
+		                    && XSyncInitialize(display.dpy, &major, &minor);
+		if (!display.have_sync) {
+			LOG_DEBUG("SYNC is not supported on this display.\n");
+		}
+	}
+#endif
+
 	// Initialise screens
 	display.nscreens = ScreenCount(display.dpy);
 	if (display.nscreens < 0) {
@@ -227,6 +251,7 @@ void display_close(void) {
 
 	free(display.screens);
 
+	loop_unwatch_fd(ConnectionNumber(display.dpy));
 	XCloseDisplay(display.dpy);
 	display.dpy = 0;
 }
@@ -242,21 +267,49 @@ void display_manage_clients(void) {
 		LOG_XDEBUG("%u windows\n", nwins);
 		LOG_XLEAVE();
 
-		// Manage all relevant windows
+		if (!wins)
+			continue;
+
+		// Rather than fetch everything for one window at a time, request
+		// attributes for all windows, then properties for all the ones
+		// we'll manage, before consuming any replies.  Adoption then
+		// costs a fixed number of round trips, not a handful per window.
+		struct winprops *wps = xmalloc(nwins * sizeof(*wps));
 		for (unsigned j = 0; j < nwins; j++) {
-			XWindowAttributes winattr;
-			XGetWindowAttributes(display.dpy, wins[j], &winattr);
+			winprops_init(&wps[j], wins[j]);
+			winprops_request(&wps[j], WINPROPS_ATTR);
+		}
+		for (unsigned j = 0; j < nwins; j++) {
+			winprops_collect(&wps[j]);
 			// Override redirect implies a pop-up that we should ignore.
 			// If map_state is not IsViewable, it shouldn't be shown right
 			// now, so don't try to manage it.
-			if (!winattr.override_redirect && winattr.map_state == IsViewable)
-				client_manage_new(wins[j], s);
+			if ((wps[j].valid & WINPROPS_ATTR)
+			    && !wps[j].attr.override_redirect
+			    && wps[j].attr.map_state == IsViewable)
+				winprops_request(&wps[j], WINPROPS_PROPS);
+		}
+
+		// Manage all relevant windows
+		for (unsigned j = 0; j < nwins; j++) {
+			if (wps[j].pending) {
+				winprops_collect(&wps[j]);
+				client_manage_new(&wps[j], s);
+			}
+			winprops_free(&wps[j]);
 		}
+		free(wps);
 		XFree(wins);
 	}
 }
 
 void display_unmanage_clients(void) {
-	while (clients_stacking_order)
-		client_remove(clients_stacking_order->data);
+	for (int i = 0; i < display.nscreens; i++) {
+		struct screen *s = &display.screens[i];
+		while (s->stacking.head)
+			client_remove(s->stacking.head);
+		// Containers are recreated as needed if clients are managed
+		// again
+		screen_destroy_containers(s);
+	}
 }
@@ -72,6 +72,10 @@ enum {
 	X_ATOM__NET_WM_PID,
 	X_ATOM__NET_FRAME_EXTENTS,
 
+	// EWMH: Window Manager Protocols
+	X_ATOM__NET_WM_SYNC_REQUEST,
+	X_ATOM__NET_WM_SYNC_REQUEST_COUNTER,
+
 	NUM_ATOMS
 };
 
@@ -101,6 +105,10 @@ struct display {
 	Bool have_randr;
 	int randr_event_base;
 #endif
+#ifdef XSYNC
+	Bool have_sync;
+	int sync_event_base;
+#endif
 
 	// Information window
 #ifdef INFOBANNER
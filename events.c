@@ -29,16 +29,17 @@
 #include "ewmh.h"
 #include "list.h"
 #include "log.h"
+#include "loop.h"
 #include "screen.h"
+#ifdef STATS
+#include "stats.h"
+#endif
 #include "util.h"
+#include "winprops.h"
 
 // Event loop will run until this flag is set
 _Bool end_event_loop;
 
-// Flags that the client list should be scanned and marked clients removed.
-// Set by unhandled X errors and unmap requests.
-int need_client_tidy = 0;
-
 // Apply the changes from an XWindowChanges struct to a client.
 
 static void do_window_changes(int value_mask, XWindowChanges *wc, struct client *c,
@@ -135,11 +136,7 @@ static void do_window_changes(int value_mask, XWindowChanges *wc, struct client
 				// place above = place under next higher
 				struct client *sc = find_client(wc->sibling);
 				if (!sc) break;
-				struct list *iter = clients_stacking_order;
-				while (iter && iter->data != sc) iter=iter->next; // back to front
-				if (!iter) break;
-				iter=iter->next;
-				client_under(c, iter?iter->data:NULL);
+				client_under(c, sc->stacking.next);
 			} else {
 				client_raise(c);
 			}
@@ -245,6 +242,12 @@ static void handle_map_request(XMapRequestEvent *e) {
 	struct client *c = find_client(e->window);
 
 	LOG_ENTER("handle_map_request(window=%lx)", (unsigned long)e->window);
+	// A window withdrawn and mapped again within one batch of events is
+	// still queued for removal: finish that first, then adopt it afresh.
+	if (c && c->remove) {
+		client_remove(c);
+		c = NULL;
+	}
 	if (c) {
 #ifdef MAPREQUEST_SHOWEXISTING
 		if (!on_vdesk(c)) switch_vdesk(c->screen, c->vdesk);
@@ -252,9 +255,14 @@ static void handle_map_request(XMapRequestEvent *e) {
 		client_raise(c);
 #endif
 	} else {
-		XWindowAttributes attr;
-		XGetWindowAttributes(display.dpy, e->window, &attr);
-		client_manage_new(e->window, find_screen(attr.root));
+		struct winprops wp;
+		winprops_init(&wp, e->window);
+		// Everything needed to adopt the window is requested at once,
+		// so the map costs a single round trip.
+		winprops_request(&wp, WINPROPS_ATTR | WINPROPS_PROPS | WINPROPS_POINTER);
+		winprops_collect(&wp);
+		client_manage_new(&wp, find_screen(wp.attr.root));
+		winprops_free(&wp);
 	}
 	LOG_LEAVE();
 }
@@ -269,15 +277,32 @@ static void handle_unmap_event(XUnmapEvent *e) {
 			LOG_XDEBUG("ignored (%d ignores remaining)\n", c->ignore_unmap);
 		} else {
 			LOG_XDEBUG("flagging client for removal\n");
-			c->remove = 1;
-			need_client_tidy = 1;
+			client_remove_later(c);
 		}
 	} else {
 		LOG_XDEBUG("unknown client!\n");
+		// Might be an unmanaged desktop window
+		struct screen *s = find_screen(e->event);
+		if (s)
+			screen_remove_desktop(s, e->window);
 	}
 	LOG_XLEAVE();
 }
 
+// Frames select SubstructureNotify, so we hear when a client window is
+// destroyed.  Usually it will have been unmapped first, and already be
+// queued for removal, but either way there's no point trying to restore
+// anything on the window itself.
+
+static void handle_destroy_event(XDestroyWindowEvent *e) {
+	struct client *c = find_client(e->window);
+	if (c && c->window == e->window) {
+		LOG_XDEBUG("handle_destroy_event(window=%lx)\n", (unsigned long)e->window);
+		c->destroyed = 1;
+		client_remove_later(c);
+	}
+}
+
 static void handle_colormap_change(XColormapEvent *e) {
 	struct client *c = find_client(e->window);
 
@@ -306,6 +331,7 @@ static void handle_property_change(XPropertyEvent *e) {
 		LOG_DEBUG("geometry=%dx%d+%d+%d\n", c->width, c->height, c->x, c->y);
 	} else if (e->atom == X_ATOM(_NET_WM_WINDOW_TYPE)) {
 		get_window_type(c);
+		client_update_container(c);
 		if (is_visible(c)) client_show(c);
 	}
 	LOG_LEAVE();
@@ -316,8 +342,7 @@ static void handle_enter_event(XCrossingEvent *e) {
 
 	if (c) {
 		if (!is_visible(c)) return;
-		client_select(c);
-		clients_tab_order = list_to_head(clients_tab_order, c);
+		client_select_later(c);
 	}
 }
 
@@ -342,17 +367,10 @@ static void handle_shape_event(XShapeEvent *e) {
 #ifdef RANDR
 static void handle_randr_event(XRRScreenChangeNotifyEvent *e) {
 	struct screen *s = find_screen(e->root);
-	// Record geometries of clients relative to monitor
-	scan_clients_before_resize(s);
 	// Update Xlib's idea of screen size
 	XRRUpdateConfiguration((XEvent*)e);
-	// Scan new monitor list
-	screen_probe_monitors(s);
-	// Fix any clients that are now not visible on any monitor.  Also
-	// adjusts maximised geometries where appropriate.
-	fix_screen_after_resize(s);
-	// Update various EWMH properties that reflect screen geometry
-	ewmh_set_screen_workarea(s);
+	if (s)
+		screen_resize_later(s);
 }
 #endif
 
@@ -522,96 +540,121 @@ static void handle_client_message(XClientMessageEvent *e) {
 	LOG_LEAVE();
 }
 
-// Run the main event loop.  This will run until something tells us to quit
-// (generally, a signal).
+// Flush deferred property updates for all clients and screens.
 
-void event_main_loop(void) {
-	// XEvent is a big union of all the core event types, but we also need
-	// to handle events about extensions, so make a union of the union...
-	union {
-		XEvent xevent;
-#ifdef SHAPE
-		XShapeEvent xshape;
-#endif
-#ifdef RANDR
-		XRRScreenChangeNotifyEvent xrandr;
-#endif
-	} ev;
+static void commit_changes(void) {
+	client_commit();
+	for (int i = 0; i < display.nscreens; i++)
+		screen_commit(&display.screens[i]);
+}
 
-	// Main event loop
-	while (!end_event_loop) {
-		if (interruptibleXNextEvent(&ev.xevent)) {
-			if ( ev.xevent.type!=UnmapNotify && ev.xevent.type!=DestroyNotify && ev.xevent.type!=EnterNotify && ev.xevent.type!=ColormapNotify ) {
-				if (initialising) LOG_XDEBUG("Resetting initialising from 0x%lx to NULL\n",initialising);
-				initialising = None;
-				if (removing) LOG_XDEBUG("Resetting removing from 0x%lx to NULL\n",removing);
-				removing = None;
-				removing_parent = None;
-			}
-			LOG_XDEBUG("%s:",xevent_string(ev.xevent.type));
+// Dispatch one event.  XEvent is big enough to hold any extension event
+// too, so those are just cast to their own type.
 
-			switch (ev.xevent.type) {
-			case KeyPress:
-			case ButtonPress:
-				bind_handle(&ev.xevent.xkey);
-				break;
+static void handle_event(XEvent *ev) {
+#ifdef STATS
+	uint64_t t0 = monotonic_ns();
+#endif
+	LOG_XDEBUG("%s:",xevent_string(ev->type));
+
+	switch (ev->type) {
+	case KeyPress:
+	case ButtonPress:
+		bind_handle(&ev->xkey);
+		break;
 #ifdef CONFIGREQ
-			case ConfigureRequest:
-				handle_configure_request(&ev.xevent.xconfigurerequest);
-				break;
+	case ConfigureRequest:
+		handle_configure_request(&ev->xconfigurerequest);
+		break;
 #endif
-			case ConfigureNotify:
-				handle_configure_notify(&ev.xevent.xconfigure);
-				break;
-			case MapRequest:
-				handle_map_request(&ev.xevent.xmaprequest);
-				break;
-			case ColormapNotify:
-				handle_colormap_change(&ev.xevent.xcolormap);
-				break;
-			case EnterNotify:
-				handle_enter_event(&ev.xevent.xcrossing);
-				break;
-			case PropertyNotify:
-				handle_property_change(&ev.xevent.xproperty);
-				break;
-			case UnmapNotify:
-				handle_unmap_event(&ev.xevent.xunmap);
-				break;
-			case MappingNotify:
-				handle_mappingnotify_event(&ev.xevent.xmapping);
-				break;
-			case ClientMessage:
-				handle_client_message(&ev.xevent.xclient);
-				break;
-			default:
+	case ConfigureNotify:
+		handle_configure_notify(&ev->xconfigure);
+		break;
+	case MapRequest:
+		handle_map_request(&ev->xmaprequest);
+		break;
+	case ColormapNotify:
+		handle_colormap_change(&ev->xcolormap);
+		break;
+	case EnterNotify:
+		handle_enter_event(&ev->xcrossing);
+		break;
+	case PropertyNotify:
+		handle_property_change(&ev->xproperty);
+		break;
+	case UnmapNotify:
+		handle_unmap_event(&ev->xunmap);
+		break;
+	case DestroyNotify:
+		handle_destroy_event(&ev->xdestroywindow);
+		break;
+	case MappingNotify:
+		handle_mappingnotify_event(&ev->xmapping);
+		break;
+	case ClientMessage:
+		handle_client_message(&ev->xclient);
+		break;
+	default:
 #ifdef SHAPE
-				if (display.have_shape && ev.xevent.type == display.shape_event) {
-					handle_shape_event(&ev.xshape);
-					break;
-				}
+		if (display.have_shape && ev->type == display.shape_event) {
+			handle_shape_event((XShapeEvent *)ev);
+			break;
+		}
 #endif
 #ifdef RANDR
-				if (display.have_randr && ev.xevent.type == display.randr_event_base + RRScreenChangeNotify) {
-					handle_randr_event(&ev.xrandr);
-					break;
-				}
-#endif
-				LOG_XDEBUG("%s\n", xevent_string(ev.xevent.type));
-				break;
-			}
+		if (display.have_randr && ev->type == display.randr_event_base + RRScreenChangeNotify) {
+			handle_randr_event((XRRScreenChangeNotifyEvent *)ev);
+			break;
 		}
+#endif
+		LOG_XDEBUG("%s\n", xevent_string(ev->type));
+		break;
+	}
+#ifdef STATS
+	stats_record_event(ev->type, t0);
+#endif
+}
 
-		// Scan list for clients flagged to be removed
-		if (need_client_tidy) {
-			struct list *iter, *niter;
-			need_client_tidy = 0;
-			for (iter = clients_tab_order; iter; iter = niter) {
-				struct client *c = iter->data;
-				niter = iter->next;
-				if (c->remove)
-					client_remove(c);
-			}
+// Remove clients queued for removal
+
+static void tidy_clients(void) {
+#ifdef STATS
+	uint64_t t0 = monotonic_ns();
+#endif
+	client_remove_queued();
+#ifdef STATS
+	stats_record_tidy(t0);
+#endif
+}
+
+// Run the main event loop.  This will run until something tells us to quit
+// (generally, a signal).
+
+void event_main_loop(void) {
+	while (!end_event_loop) {
+		// Handle the events already read, but no more: under a
+		// constant stream of events, signals and timers must still get
+		// their turn below.
+		int n = XEventsQueued(display.dpy, QueuedAlready);
+		while (!end_event_loop && n-- > 0) {
+			XEvent ev;
+			XNextEvent(display.dpy, &ev);
+			handle_event(&ev);
 		}
+
+		// Remove clients whose windows went away in that batch
+		if (clients_remove_queue.head)
+			tidy_clients();
+
+		// Write out the property updates deferred while handling them
+		commit_changes();
+
+		// Wait for something else to happen.  If more events have
+		// arrived, just run any signals or timers that are due.
+		// XPending() flushes output and reads whatever is available.
+		if (XPending(display.dpy))
+			loop_poll();
+		else
+			loop_wait();
 	}
 }
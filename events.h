@@ -13,10 +13,6 @@
 // Event loop will run until this flag is set
 extern _Bool end_event_loop;
 
-// Flags that the client list should be scanned and marked clients removed.
-// Set by unhandled X errors and unmap requests.
-extern int need_client_tidy;
-
 // The main event loop - this will run until something signals the window
 // manager to quit.
 
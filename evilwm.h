@@ -20,12 +20,20 @@
 #define DEF_ALTMASK     "shift"
 #define DEF_SOLIDDRAG   1
 #define DEF_SOLIDSWEEP  0
+#define DEF_FRAMERATE   60
+#ifdef SHAPE_OUTLINE
+#define DEF_OUTLINE     "shape"
+#else
+#define DEF_OUTLINE     "window"
+#endif
 #define DEF_DOCKS       1
 #ifdef DEBIAN
 #define DEF_TERM        "x-terminal-emulator"
 #else
 #define DEF_TERM        "xterm"
 #endif
+#define DEF_TERMPOOL    0
+#define DEF_FOCUSDELAY  0
 #ifndef VERSION
 #define VERSION "?.?.?"
 #endif
@@ -64,9 +72,19 @@ struct options {
 	// Whole screen flag (ignore monitor information)
 	int wholescreen;
 
+	// Parent frames to a container window per vdesk
+	int vdeskcontainers;
+
 	// Solid drag & sweep enable flags
 	int solid_drag;
 	int solid_sweep;
+	// Outline style otherwise: "window", "shape" or "invert"
+	char *outline;
+	// Maximum updates per second while dragging or sweeping (0 = no limit)
+	int framerate;
+
+	// Delay (ms) before focus follows the pointer into a window
+	int focusdelay;
 
 	// Initial dock state
 	int docks;
@@ -74,8 +92,15 @@ struct options {
 	// disable loading the default key bindings
 	int nodefaultbinds;
 
-	// NULL-terminated array passed to execvp() to launch terminal
+	// NULL-terminated array passed to posix_spawnp() to launch terminal
 	char **term;
+	// Number of hidden terminals to keep ready per screen
+	int termpool;
+
+#ifdef STATS
+	// Event loop statistics are appended here on SIGUSR1 (else stderr)
+	char *statsfile;
+#endif
 };
 
 extern struct options option;
@@ -9,8 +9,8 @@
 #endif
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
-#include <math.h>
 
 #include <X11/X.h>
 #include <X11/Xlib.h>
@@ -23,16 +23,6 @@
 #include "screen.h"
 #include "util.h"
 
-// Maintain a reasonably sized allocated block of memory for lists
-// of windows (for feeding to XChangeProperty in one hit).
-static Window *window_array = NULL;
-// stores allocated length of window_array
-static unsigned window_array_n = 0;
-// args: client list, screen for filter
-// returns: array length
-// reallocates window_array if needed
-static unsigned fill_window_array(struct list *, struct screen *);
-
 #define save_DEBUG DEBUG
 // #undef DEBUG
 
@@ -56,26 +46,67 @@ void ewmh_set_screen_workarea(struct screen *s) {
 			(unsigned char *)&workarea, 4);
 }
 
-// Update the _NET_CLIENT_LIST property for a screen.  This is a simple list of
-// all client windows in the order they were mapped.
+// The _NET_CLIENT_LIST property for a screen is a simple list of all client
+// windows in the order they were mapped.  A copy is kept per screen, so that
+// newly mapped windows can just be appended to the property.  Removing one
+// means rewriting the whole thing, but that's left to screen_commit(), so
+// happens at most once per batch of events.
+
+void ewmh_client_list_add(struct client *c) {
+	struct screen *s = c->screen;
+	window_array_add(&s->client_list, c->window);
+	s->dirty |= SCREEN_DIRTY_CLIENT_LIST_APPEND;
+}
+
+void ewmh_client_list_remove(struct client *c) {
+	struct screen *s = c->screen;
+	struct window_array *a = &s->client_list;
+	for (unsigned i = 0; i < a->n; i++) {
+		if (a->w[i] != c->window)
+			continue;
+		memmove(&a->w[i], &a->w[i+1], (a->n - i - 1) * sizeof(Window));
+		a->n--;
+		// No need to rewrite if it was never written
+		if (i < s->client_list_written)
+			s->dirty |= SCREEN_DIRTY_CLIENT_LIST;
+		return;
+	}
+}
+
+// Write out _NET_CLIENT_LIST: either in full, or just what's been appended.
 
 void ewmh_set_net_client_list(struct screen *s) {
-	LOG_DEBUG("clients_mapping_order: ");
-	unsigned i = fill_window_array(clients_mapping_order, s);
-	XChangeProperty(display.dpy, s->root, X_ATOM(_NET_CLIENT_LIST),
-			XA_WINDOW, 32, PropModeReplace,
-			(unsigned char *)window_array, i);
+	struct window_array *a = &s->client_list;
+	if (s->dirty & SCREEN_DIRTY_CLIENT_LIST) {
+		LOG_DEBUG("_NET_CLIENT_LIST: %u windows\n", a->n);
+		XChangeProperty(display.dpy, s->root, X_ATOM(_NET_CLIENT_LIST),
+				XA_WINDOW, 32, PropModeReplace,
+				(unsigned char *)a->w, a->n);
+	} else if (s->client_list_written < a->n) {
+		LOG_DEBUG("_NET_CLIENT_LIST: %u windows appended\n", a->n - s->client_list_written);
+		XChangeProperty(display.dpy, s->root, X_ATOM(_NET_CLIENT_LIST),
+				XA_WINDOW, 32, PropModeAppend,
+				(unsigned char *)&a->w[s->client_list_written],
+				a->n - s->client_list_written);
+	}
+	s->client_list_written = a->n;
 }
 
 // Update the _NET_CLIENT_LIST_STACKING property for a screen.  Similar to
-// _NET_CLIENT_LIST, but in stacking order (bottom to top).
+// _NET_CLIENT_LIST, but in stacking order (bottom to top).  Restacking can
+// move any window, so this is always rewritten in full.
 
 void ewmh_set_net_client_list_stacking(struct screen *s) {
-	LOG_DEBUG("clients_stacking_order: ");
-	unsigned i = fill_window_array(clients_stacking_order, s);
+	struct window_array *a = &s->stacking_list;
+	a->n = 0;
+	for (struct client *c = s->stacking.head; c; c = c->stacking.next) {
+		if (c->vdesk == VDESK_POOL) continue;  // not for pagers to see
+		window_array_add(a, c->window);
+	}
+	LOG_DEBUG("_NET_CLIENT_LIST_STACKING: %u windows\n", a->n);
 	XChangeProperty(display.dpy, s->root, X_ATOM(_NET_CLIENT_LIST_STACKING),
 			XA_WINDOW, 32, PropModeReplace,
-			(unsigned char *)window_array, i);
+			(unsigned char *)a->w, a->n);
 }
 
 // Update _NET_CURRENT_DESKTOP for screen to currently selected vdesk.
@@ -114,7 +145,7 @@ void ewmh_set_allowed_actions(struct client *c) {
 	// As this function is only called when creating a client, take this
 	// opportunity to set any initial state on its window.  In particular,
 	// I'm interested in docks immediately getting focussed state.
-	ewmh_set_net_wm_state(c);
+	client_dirty(c, CLIENT_DIRTY_NET_WM_STATE);
 }
 
 // When window manager is shutting down, the _NET_WM_ALLOWED_ACTIONS property
@@ -134,9 +165,14 @@ void ewmh_withdraw_client(struct client *c) {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
 // Update _NET_WM_DESKTOP to reflect virtual desktop of client (including
-// fixed, 0xffffffff).
+// fixed, 0xffffffff).  Pooled terminals aren't on any desktop a pager should
+// know about, so have none until taken from the pool.
 
 void ewmh_set_net_wm_desktop(struct client *c) {
+	if (c->vdesk == VDESK_POOL) {
+		XDeleteProperty(display.dpy, c->window, X_ATOM(_NET_WM_DESKTOP));
+		return;
+	}
 	unsigned long vdesk = c->vdesk;
 	XChangeProperty(display.dpy, c->window, X_ATOM(_NET_WM_DESKTOP),
 			XA_CARDINAL, 32, PropModeReplace,
@@ -147,22 +183,41 @@ void ewmh_set_net_wm_desktop(struct client *c) {
 
 unsigned ewmh_get_net_wm_window_type(Window w) {
 	Atom *aprop;
-	unsigned long nitems, i;
+	unsigned long nitems;
 	unsigned type = 0;
 	if ( (aprop = get_property(w, X_ATOM(_NET_WM_WINDOW_TYPE), XA_ATOM, &nitems)) ) {
-		for (i = 0; i < nitems; i++) {
-			if (aprop[i] == X_ATOM(_NET_WM_WINDOW_TYPE_DESKTOP))
-				type |= EWMH_WINDOW_TYPE_DESKTOP;
-			if (aprop[i] == X_ATOM(_NET_WM_WINDOW_TYPE_DOCK))
-				type |= EWMH_WINDOW_TYPE_DOCK;
-			if (aprop[i] == X_ATOM(_NET_WM_WINDOW_TYPE_NOTIFICATION))
-				type |= EWMH_WINDOW_TYPE_NOTIFICATION;
-		}
+		type = ewmh_parse_net_wm_window_type(aprop, nitems);
 		XFree(aprop);
 	}
 	return type;
 }
 
+// Same, given already-fetched property data.
+
+unsigned ewmh_parse_net_wm_window_type(const Atom *aprop, unsigned long nitems) {
+	unsigned type = 0;
+	for (unsigned long i = 0; i < nitems; i++) {
+		if (aprop[i] == X_ATOM(_NET_WM_WINDOW_TYPE_DESKTOP))
+			type |= EWMH_WINDOW_TYPE_DESKTOP;
+		if (aprop[i] == X_ATOM(_NET_WM_WINDOW_TYPE_DOCK))
+			type |= EWMH_WINDOW_TYPE_DOCK;
+		if (aprop[i] == X_ATOM(_NET_WM_WINDOW_TYPE_NOTIFICATION))
+			type |= EWMH_WINDOW_TYPE_NOTIFICATION;
+	}
+	return type;
+}
+
+// Update _NET_ACTIVE_WINDOW for screen, if it has changed.
+
+void ewmh_set_net_active_window(struct screen *s, Window w) {
+	if (s->active == w)
+		return;
+	XChangeProperty(display.dpy, s->root, X_ATOM(_NET_ACTIVE_WINDOW),
+	                XA_WINDOW, 32, PropModeReplace,
+	                (unsigned char *)&w, 1);
+	s->active = w;
+}
+
 // Update _NET_WM_STATE_* properties on a window.  Also updates
 // _NET_ACTIVE_WINDOW on the client's screen if necessary.
 
@@ -178,19 +233,9 @@ void ewmh_set_net_wm_state(struct client *c) {
 	if (c == current || c->is_dock)
 		state[i++] = X_ATOM(_NET_WM_STATE_FOCUSED);
 	if (c == current) {
-		if (c->screen->active != c->window) {
-			XChangeProperty(display.dpy, c->screen->root,
-			                X_ATOM(_NET_ACTIVE_WINDOW),
-			                XA_WINDOW, 32, PropModeReplace,
-			                (unsigned char *)&c->window, 1);
-			c->screen->active = c->window;
-		}
+		ewmh_set_net_active_window(c->screen, c->window);
 	} else if (c->screen->active == c->window) {
-		Window w = None;
-		XChangeProperty(display.dpy, c->screen->root, X_ATOM(_NET_ACTIVE_WINDOW),
-		                XA_WINDOW, 32, PropModeReplace,
-		                (unsigned char *)&w, 1);
-		c->screen->active = None;
+		ewmh_set_net_active_window(c->screen, None);
 	}
 	XChangeProperty(display.dpy, c->window, X_ATOM(_NET_WM_STATE),
 			XA_ATOM, 32, PropModeReplace,
@@ -208,45 +253,6 @@ void ewmh_set_net_frame_extents(Window w, unsigned long border) {
 			(unsigned char *)&extents, 4);
 }
 
-// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-
-// Allocate/resize an array suitable to hold all client window ids.
-//
-// XXX should test that this can be allocated before we commit to managing a
-// window, in the same way that we test the client structure allocation.
-
-static void alloc_window_array(struct list *iter, unsigned count, struct screen *s) {
-	if (iter) while ((iter = iter->next)) if (((struct client *)iter->data)->screen==s) count++;
-	count = 1<<(1+(int)log2(count-1)); // least greater power of two
-	if (window_array_n > count && window_array_n >>2 < count)
-		return; // fuzzy boundary
-	if (count<16)
-		count=16; // min
-	if (window_array_n==count)
-		return; // equal (can remove, since realloc probably checks anyway)
-	LOG_DEBUG("alloc_window_array(): realloc from %u to %u\n",window_array_n,count);
-	window_array_n = count;
-	window_array = realloc(window_array, window_array_n * sizeof(Window));
-}
-
-// Fill/realloc said array as needed
-
-static unsigned fill_window_array(struct list *list, struct screen *s) {
-	unsigned i = 0;
-	LOG_DEBUG_("{");
-	for (struct list *iter = list; iter; iter = iter->next) {
-		struct client *c = iter->data;
-		if (c->screen != s) continue;
-		if (i+1 > window_array_n) alloc_window_array(iter,i+1,s);
-		window_array[i] = c->window;
-		LOG_DEBUG_("%lxw%lx,",c->window/0x100000,c->window&0xFFFFF);
-		i++;
-	}
-	LOG_DEBUG_("}, %u items, array[%u]\n", i, window_array_n);
-	alloc_window_array(NULL,i,s); // shrink if needed
-	return i;
-}
-
 #undef DEBUG
 #define DEBUG save_DEBUG
 #undef save_DEBUG
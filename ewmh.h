@@ -20,9 +20,12 @@ struct client;
 struct screen;
 
 void ewmh_set_screen_workarea(struct screen *s);
+void ewmh_client_list_add(struct client *c);
+void ewmh_client_list_remove(struct client *c);
 void ewmh_set_net_client_list(struct screen *s);
 void ewmh_set_net_client_list_stacking(struct screen *s);
 void ewmh_set_net_current_desktop(struct screen *s);
+void ewmh_set_net_active_window(struct screen *s, Window w);
 
 void ewmh_set_allowed_actions(struct client *c);
 void ewmh_remove_allowed_actions(struct client *c);
@@ -30,6 +33,7 @@ void ewmh_withdraw_client(struct client *c);
 
 void ewmh_set_net_wm_desktop(struct client *c);
 unsigned ewmh_get_net_wm_window_type(Window w);
+unsigned ewmh_parse_net_wm_window_type(const Atom *aprop, unsigned long nitems);
 void ewmh_set_net_wm_state(struct client *c);
 void ewmh_set_net_frame_extents(Window w, unsigned long border);
 
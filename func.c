@@ -25,6 +25,7 @@
 #include "list.h"
 #include "log.h"
 #include "screen.h"
+#include "termpool.h"
 #include "util.h"
 
 static void check_client_dims(struct client *c) {
@@ -204,7 +205,7 @@ void func_next(void *sptr, XEvent *e, unsigned flags) {
 		XUngrabKeyboard(display.dpy, CurrentTime);
 		XUngrabPointer(display.dpy, CurrentTime);
 	}
-	clients_tab_order = list_to_head(clients_tab_order, current);
+	dlist_to_head(&clients_tab_order, current);
 }
 
 void func_raise(void *sptr, XEvent *e, unsigned flags) {
@@ -270,9 +271,14 @@ void func_resize(void *sptr, XEvent *e, unsigned flags) {
 
 void func_spawn(void *sptr, XEvent *e, unsigned flags) {
 	(void)sptr;
-	(void)e;
 	(void)flags;
-	spawn((const char *const *)option.term);
+	// Key & button events both carry the root window and pointer
+	// position, which saves asking the server.
+	struct screen *s = find_screen(e->xkey.root);
+	if (!termpool_take(s, e->xkey.x_root, e->xkey.y_root))
+		spawn(s, (const char *const *)option.term);
+	if (s)
+		termpool_fill(s);
 }
 
 void func_fix(void *sptr, XEvent *e, unsigned flags) {
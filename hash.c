@@ -0,0 +1,106 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Basic hash table code.  Open addressing with linear probing; the table is
+// kept at most half full, and deletion shifts following entries back rather
+// than leaving tombstones, so lookups stay short however many windows have
+// come and gone.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "hash.h"
+#include "xalloc.h"
+
+#define HASH_MIN_SIZE 64
+
+// X resource IDs are allocated sequentially within a client's ID range, so
+// the low bits vary most.  Mix in the high bits anyway so that IDs from
+// different X clients don't cluster.
+
+static unsigned slot_for(const struct hash *hash, unsigned long key) {
+	key ^= key >> 16;
+	key *= 0x45d9f3bUL;
+	key ^= key >> 16;
+	return (unsigned)key & (hash->size - 1);
+}
+
+static void resize(struct hash *hash, unsigned size) {
+	struct hash_entry *old = hash->entries;
+	unsigned old_size = hash->size;
+	hash->entries = xzalloc(size * sizeof(struct hash_entry));
+	hash->size = size;
+	hash->count = 0;
+	for (unsigned i = 0; i < old_size; i++) {
+		if (old[i].key)
+			hash_insert(hash, old[i].key, old[i].data);
+	}
+	free(old);
+}
+
+// Add or replace the data associated with key
+
+void hash_insert(struct hash *hash, unsigned long key, void *data) {
+	if (!key)
+		return;
+	if ((hash->count + 1) * 2 > hash->size)
+		resize(hash, hash->size ? hash->size * 2 : HASH_MIN_SIZE);
+	unsigned mask = hash->size - 1;
+	unsigned i = slot_for(hash, key);
+	while (hash->entries[i].key && hash->entries[i].key != key)
+		i = (i + 1) & mask;
+	if (!hash->entries[i].key)
+		hash->count++;
+	hash->entries[i] = (struct hash_entry){ key, data };
+}
+
+// Remove entry for key.  Any entries in the same run that could have lived
+// in the freed slot are shifted back into it.
+
+void hash_delete(struct hash *hash, unsigned long key) {
+	if (!key || !hash->count)
+		return;
+	unsigned mask = hash->size - 1;
+	unsigned i = slot_for(hash, key);
+	while (hash->entries[i].key != key) {
+		if (!hash->entries[i].key)
+			return;  // not found
+		i = (i + 1) & mask;
+	}
+	unsigned j = i;
+	for (;;) {
+		j = (j + 1) & mask;
+		if (!hash->entries[j].key)
+			break;
+		unsigned k = slot_for(hash, hash->entries[j].key);
+		// Entry at j stays put if its home slot lies cyclically in (i,j]
+		if ((i < j) ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		hash->entries[i] = hash->entries[j];
+		i = j;
+	}
+	hash->entries[i] = (struct hash_entry){ 0, NULL };
+	hash->count--;
+}
+
+// Find data associated with key
+
+void *hash_find(const struct hash *hash, unsigned long key) {
+	if (!key || !hash->count)
+		return NULL;
+	unsigned mask = hash->size - 1;
+	for (unsigned i = slot_for(hash, key); hash->entries[i].key; i = (i + 1) & mask) {
+		if (hash->entries[i].key == key)
+			return hash->entries[i].data;
+	}
+	return NULL;
+}
+
+void hash_clear(struct hash *hash) {
+	free(hash->entries);
+	*hash = (struct hash){ 0 };
+}
@@ -0,0 +1,35 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Basic hash table code.  Maps non-zero integer keys (generally X resource
+// IDs) to pointers using open addressing with linear probing, so a lookup is
+// a short scan of one contiguous array rather than a walk through a list.
+
+#ifndef EVILWM_HASH_H__
+#define EVILWM_HASH_H__
+
+struct hash_entry {
+	unsigned long key;  // 0 marks an empty slot
+	void *data;
+};
+
+struct hash {
+	struct hash_entry *entries;
+	unsigned size;   // number of slots, always zero or a power of two
+	unsigned count;  // number of occupied slots
+};
+
+// Add or replace the data associated with key.  Key must be non-zero.
+void hash_insert(struct hash *hash, unsigned long key, void *data);
+
+// Remove any entry for key.
+void hash_delete(struct hash *hash, unsigned long key);
+
+// Returns data associated with key, or NULL if not found.
+void *hash_find(const struct hash *hash, unsigned long key);
+
+// Free all storage used by the table, leaving it empty.
+void hash_clear(struct hash *hash);
+
+#endif
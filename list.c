@@ -116,3 +116,61 @@ struct list *list_find_prev(struct list *list, void *data) {
 	if (!list->next) return NULL;
 	return list;
 }
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+// Intrusive doubly-linked lists
+
+_Bool dlist_contains(struct dlist *list, void *data) {
+	struct dlist_link *link = dlist_link(list, data);
+	return link->prev || link->next || list->head == data;
+}
+
+void dlist_insert_before(struct dlist *list, void *data, void *before) {
+	struct dlist_link *link = dlist_link(list, data);
+	link->next = before;
+	link->prev = before ? dlist_prev(list, before) : list->tail;
+	if (link->prev)
+		dlist_next(list, link->prev) = data;
+	else
+		list->head = data;
+	if (before)
+		dlist_prev(list, before) = data;
+	else
+		list->tail = data;
+}
+
+void dlist_prepend(struct dlist *list, void *data) {
+	dlist_insert_before(list, data, list->head);
+}
+
+void dlist_append(struct dlist *list, void *data) {
+	dlist_insert_before(list, data, NULL);
+}
+
+void dlist_delete(struct dlist *list, void *data) {
+	if (!data || !dlist_contains(list, data))
+		return;
+	struct dlist_link *link = dlist_link(list, data);
+	if (link->prev)
+		dlist_next(list, link->prev) = link->next;
+	else
+		list->head = link->next;
+	if (link->next)
+		dlist_prev(list, link->next) = link->prev;
+	else
+		list->tail = link->prev;
+	*link = (struct dlist_link){ NULL, NULL };
+}
+
+void dlist_to_head(struct dlist *list, void *data) {
+	if (!data || list->head == data) return; // already there
+	dlist_delete(list, data);
+	dlist_prepend(list, data);
+}
+
+void dlist_to_tail(struct dlist *list, void *data) {
+	if (!data || list->tail == data) return; // already there
+	dlist_delete(list, data);
+	dlist_append(list, data);
+}
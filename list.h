@@ -8,6 +8,8 @@
 #ifndef EVILWM_LIST_H__
 #define EVILWM_LIST_H__
 
+#include <stddef.h>
+
 // Each list element is of this deliberately transparent type:
 struct list {
 	struct list *next;
@@ -31,4 +33,47 @@ struct list *list_reverse(struct list *list, void *);
 struct list *list_find(struct list *list, void *data);
 struct list *list_find_prev(struct list *list, void *data);
 
+// Intrusive doubly-linked lists.  Each element embeds a struct dlist_link for
+// every list it can be on, and the list records where that link lives within
+// the element.  Insertion, deletion and moving an element to either end are
+// constant time and never allocate.
+
+struct dlist_link {
+	void *prev;
+	void *next;
+};
+
+struct dlist {
+	void *head;
+	void *tail;
+	size_t link;  // offset of struct dlist_link within each element
+};
+
+#define DLIST_INIT(type, member) { NULL, NULL, offsetof(type, member) }
+
+// Link within element
+#define dlist_link(list, data) ((struct dlist_link *)((char *)(data) + (list)->link))
+
+// Neighbouring elements (NULL at either end)
+#define dlist_next(list, data) (dlist_link(list, data)->next)
+#define dlist_prev(list, data) (dlist_link(list, data)->prev)
+
+// Add element to head or tail of list.  Element must not already be on it.
+void dlist_prepend(struct dlist *list, void *data);
+void dlist_append(struct dlist *list, void *data);
+
+// Insert element directly before 'before' (which must be on the list), or at
+// the tail if 'before' is NULL.
+void dlist_insert_before(struct dlist *list, void *data, void *before);
+
+// Unlink element from list.  Harmless if it isn't on the list.
+void dlist_delete(struct dlist *list, void *data);
+
+// Move element to head or tail of list, adding it if not already present.
+void dlist_to_head(struct dlist *list, void *data);
+void dlist_to_tail(struct dlist *list, void *data);
+
+// Test if element is on the list.
+_Bool dlist_contains(struct dlist *list, void *data);
+
 #endif
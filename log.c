@@ -34,7 +34,7 @@ const char *debug_atom_name(Atom a) {
 
 #endif
 
-#ifdef XDEBUG
+#if defined(XDEBUG) || defined(STATS)
 
 const char *xevent_string(int event) {
 	// /usr/include/X11/X.h
@@ -81,6 +81,10 @@ const char *xevent_string(int event) {
 	return ((unsigned)event < 37) ? events[event] : events[37];
 }
 
+#endif
+
+#ifdef XDEBUG
+
 static const char *gravity_string(int gravity) {
 	const char *gravities[12] = {
 		"ForgetGravity",
@@ -51,6 +51,21 @@ const char *debug_atom_name(Atom a);
 
 #endif
 
+// Trace macros, for timing latency-critical paths (with monotonic_ns() from
+// util.h):
+//
+// LOG_TRACE(...)    print "trace: " prefixed message
+
+#ifdef TRACE
+
+# define LOG_TRACE(...) fprintf(stderr, "trace: " __VA_ARGS__)
+
+#else
+
+# define LOG_TRACE(...) do {} while (0)
+
+#endif
+
 // X call debugging macros:
 
 #ifdef XDEBUG
@@ -64,8 +79,6 @@ const char *debug_atom_name(Atom a);
 void debug_window_attributes(XWindowAttributes *attr);
 // Dump size hints
 void debug_wm_normal_hints(XSizeHints *size);
-// Get XEvent type as string
-const char *xevent_string(int event);
 
 #else
 
@@ -74,9 +87,14 @@ const char *xevent_string(int event);
 # define LOG_XDEBUG(...) do {} while (0)
 # define LOG_XDEBUG_(...) do {} while (0)
 
-# define debug_window_attributes(a)
-# define debug_wm_normal_hints(s)
+# define debug_window_attributes(a) do {} while (0)
+# define debug_wm_normal_hints(s) do {} while (0)
 
 #endif
 
+#if defined(XDEBUG) || defined(STATS)
+// Get XEvent type as string
+const char *xevent_string(int event);
+#endif
+
 #endif
@@ -0,0 +1,391 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Main loop multiplexing
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifdef EPOLL
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#else
+#include <poll.h>
+#endif
+
+#include "log.h"
+#include "loop.h"
+#include "util.h"
+#include "xalloc.h"
+
+// Upper bound on signal numbers we'll dispatch
+#define LOOP_NSIG 65
+
+struct watch {
+	int fd;
+	void (*fn)(int fd, void *data);
+	void *data;
+};
+
+static struct watch *watches;
+static unsigned nwatches;
+
+static void (*signal_fn[LOOP_NSIG])(int signo);
+static sigset_t signal_set;  // signals registered with loop_signal()
+
+#ifdef EPOLL
+static int epoll_fd = -1;
+static int signal_fd = -1;
+#else
+static int signal_pipe[2] = { -1, -1 };
+static struct pollfd *pollfds;  // signal pipe, then one per watch
+#endif
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+// Timer wheel.  Level 0 has a slot per tick for the next WHEEL_SLOTS ticks;
+// each slot at level n covers WHEEL_SLOTS times as many ticks as at level
+// n-1.  When ticks reach the start of a higher level slot, its timers are
+// cascaded down to lower levels.  Timers further off than the wheel spans
+// (about 4.6 hours) sit in the top level, and are cascaded until they fit.
+
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1U << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_SPAN   (UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS))
+
+static struct loop_timer *wheel[WHEEL_LEVELS][WHEEL_SLOTS];
+static uint64_t wheel_tick;  // all slots up to this tick have been run
+static unsigned wheel_count;
+
+static uint64_t now_ms(void) {
+	return monotonic_ns() / 1000000;
+}
+
+static void wheel_link(struct loop_timer *t) {
+	uint64_t e = t->expires;
+	if (e < wheel_tick)
+		e = wheel_tick;
+	uint64_t delta = e - wheel_tick;
+	if (delta >= WHEEL_SPAN) {
+		delta = WHEEL_SPAN - 1;
+		e = wheel_tick + delta;
+	}
+	unsigned level = 0;
+	while (level + 1 < WHEEL_LEVELS && delta >= (UINT64_C(1) << (WHEEL_BITS * (level + 1))))
+		level++;
+	struct loop_timer **slot = &wheel[level][(e >> (WHEEL_BITS * level)) & WHEEL_MASK];
+	t->next = *slot;
+	if (t->next)
+		t->next->pprev = &t->next;
+	t->pprev = slot;
+	*slot = t;
+}
+
+static void wheel_unlink(struct loop_timer *t) {
+	*t->pprev = t->next;
+	if (t->next)
+		t->next->pprev = t->pprev;
+	t->next = NULL;
+	t->pprev = NULL;
+}
+
+// Run everything due up to and including tick 'now'.
+
+static void wheel_advance(uint64_t now) {
+	while (wheel_tick < now) {
+		if (!wheel_count) {
+			wheel_tick = now;
+			break;
+		}
+		uint64_t tick = ++wheel_tick;
+		// Cascade from the highest level whose slot starts here, so
+		// that nothing lands in a lower slot already passed.
+		unsigned top = 0;
+		while (top + 1 < WHEEL_LEVELS
+		       && !(tick & ((UINT64_C(1) << (WHEEL_BITS * (top + 1))) - 1)))
+			top++;
+		for (unsigned level = top; level > 0; level--) {
+			struct loop_timer **slot = &wheel[level][(tick >> (WHEEL_BITS * level)) & WHEEL_MASK];
+			struct loop_timer *t = *slot;
+			*slot = NULL;
+			while (t) {
+				struct loop_timer *next = t->next;
+				wheel_link(t);
+				t = next;
+			}
+		}
+		// Expire.  Callbacks may start or stop any timer, so unlink
+		// each before calling it.
+		struct loop_timer **slot = &wheel[0][tick & WHEEL_MASK];
+		struct loop_timer *t;
+		while ((t = *slot)) {
+			wheel_unlink(t);
+			wheel_count--;
+			t->fn(t->data);
+		}
+	}
+}
+
+// Milliseconds until the wheel next needs to advance, or -1 if no timers are
+// pending.  This may be a cascade rather than an expiry.
+
+static int wheel_timeout(uint64_t now) {
+	if (!wheel_count)
+		return -1;
+	uint64_t next = UINT64_MAX;
+	for (unsigned level = 0; level < WHEEL_LEVELS; level++) {
+		unsigned shift = WHEEL_BITS * level;
+		uint64_t base = wheel_tick >> shift;
+		for (unsigned k = 1; k <= WHEEL_SLOTS; k++) {
+			if (wheel[level][(base + k) & WHEEL_MASK]) {
+				if (((base + k) << shift) < next)
+					next = (base + k) << shift;
+				break;
+			}
+		}
+	}
+	if (next <= now)
+		return 0;
+	return (next - now > INT32_MAX) ? INT32_MAX : (int)(next - now);
+}
+
+void loop_timer_init(struct loop_timer *t, void (*fn)(void *), void *data) {
+	*t = (struct loop_timer){ .fn = fn, .data = data };
+}
+
+void loop_timer_start(struct loop_timer *t, unsigned ms) {
+	loop_timer_stop(t);
+	uint64_t now = now_ms();
+	if (wheel_tick < now && !wheel_count)
+		wheel_tick = now;
+	// Ticks are truncated milliseconds, so round up to never fire early.
+	// Nor can a timer be due in a slot that has already run.
+	t->expires = now + ms + 1;
+	if (t->expires <= wheel_tick)
+		t->expires = wheel_tick + 1;
+	wheel_link(t);
+	wheel_count++;
+}
+
+void loop_timer_stop(struct loop_timer *t) {
+	if (!t->pprev)
+		return;
+	wheel_unlink(t);
+	wheel_count--;
+}
+
+_Bool loop_timer_pending(const struct loop_timer *t) {
+	return t->pprev != NULL;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+static void dispatch_signal(int signo) {
+	if (signo > 0 && signo < LOOP_NSIG && signal_fn[signo])
+		signal_fn[signo](signo);
+}
+
+#ifdef EPOLL
+
+void loop_init(void) {
+	sigemptyset(&signal_set);
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd < 0) {
+		LOG_ERROR("epoll_create1() failed\n");
+		exit(1);
+	}
+}
+
+void loop_deinit(void) {
+	if (signal_fd >= 0)
+		close(signal_fd);
+	if (epoll_fd >= 0)
+		close(epoll_fd);
+	sigprocmask(SIG_UNBLOCK, &signal_set, NULL);
+	signal_fd = epoll_fd = -1;
+	free(watches);
+	watches = NULL;
+	nwatches = 0;
+}
+
+void loop_signal(int signo, void (*fn)(int signo)) {
+	if (signo <= 0 || signo >= LOOP_NSIG)
+		return;
+	signal_fn[signo] = fn;
+	sigaddset(&signal_set, signo);
+	sigprocmask(SIG_BLOCK, &signal_set, NULL);
+	int fd = signalfd(signal_fd, &signal_set, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (fd < 0) {
+		LOG_ERROR("signalfd() failed\n");
+		return;
+	}
+	if (signal_fd < 0) {
+		signal_fd = fd;
+		struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+		epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+static void read_signals(void) {
+	struct signalfd_siginfo si;
+	while (read(signal_fd, &si, sizeof(si)) == sizeof(si))
+		dispatch_signal(si.ssi_signo);
+}
+
+#else
+
+static void handle_signal(int signo) {
+	int old_errno = errno;
+	unsigned char c = signo;
+	if (write(signal_pipe[1], &c, 1) < 0) {
+		// Pipe full: signal is already pending anyway
+	}
+	errno = old_errno;
+}
+
+void loop_init(void) {
+	sigemptyset(&signal_set);
+	if (pipe(signal_pipe) < 0) {
+		LOG_ERROR("pipe() failed\n");
+		exit(1);
+	}
+	for (int i = 0; i < 2; i++) {
+		fcntl(signal_pipe[i], F_SETFL, fcntl(signal_pipe[i], F_GETFL) | O_NONBLOCK);
+		fcntl(signal_pipe[i], F_SETFD, FD_CLOEXEC);
+	}
+	pollfds = xrealloc(pollfds, sizeof(*pollfds));
+	pollfds[0] = (struct pollfd){ .fd = signal_pipe[0], .events = POLLIN };
+}
+
+void loop_deinit(void) {
+	for (int signo = 1; signo < LOOP_NSIG; signo++) {
+		if (sigismember(&signal_set, signo) == 1)
+			signal(signo, SIG_DFL);
+	}
+	close(signal_pipe[0]);
+	close(signal_pipe[1]);
+	signal_pipe[0] = signal_pipe[1] = -1;
+	free(pollfds);
+	pollfds = NULL;
+	free(watches);
+	watches = NULL;
+	nwatches = 0;
+}
+
+void loop_signal(int signo, void (*fn)(int signo)) {
+	if (signo <= 0 || signo >= LOOP_NSIG)
+		return;
+	signal_fn[signo] = fn;
+	sigaddset(&signal_set, signo);
+	struct sigaction act = {
+		.sa_handler = handle_signal,
+		.sa_flags = 0,
+	};
+	sigemptyset(&act.sa_mask);
+	sigaction(signo, &act, NULL);
+}
+
+static void read_signals(void) {
+	unsigned char c;
+	while (read(signal_pipe[0], &c, 1) == 1)
+		dispatch_signal(c);
+}
+
+#endif
+
+void loop_signals(sigset_t *set) {
+	*set = signal_set;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void loop_watch_fd(int fd, void (*fn)(int fd, void *data), void *data) {
+	watches = xrealloc(watches, (nwatches + 1) * sizeof(*watches));
+	watches[nwatches++] = (struct watch){ .fd = fd, .fn = fn, .data = data };
+#ifdef EPOLL
+	struct epoll_event ev = { .events = EPOLLIN, .data.fd = fd };
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		LOG_ERROR("epoll_ctl() failed to add fd %d\n", fd);
+#else
+	pollfds = xrealloc(pollfds, (nwatches + 1) * sizeof(*pollfds));
+	pollfds[nwatches] = (struct pollfd){ .fd = fd, .events = POLLIN };
+#endif
+}
+
+void loop_unwatch_fd(int fd) {
+	for (unsigned i = 0; i < nwatches; i++) {
+		if (watches[i].fd == fd) {
+			watches[i] = watches[--nwatches];
+#ifdef EPOLL
+			epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+#else
+			pollfds[i+1] = pollfds[nwatches+1];
+#endif
+			return;
+		}
+	}
+}
+
+static void dispatch_fd(int fd) {
+	for (unsigned i = 0; i < nwatches; i++) {
+		if (watches[i].fd == fd) {
+			if (watches[i].fn)
+				watches[i].fn(fd, watches[i].data);
+			return;
+		}
+	}
+}
+
+#ifdef EPOLL
+
+static void wait_timeout(int timeout) {
+	struct epoll_event evs[8];
+	int n = epoll_wait(epoll_fd, evs, 8, timeout);
+	if (n < 0 && errno != EINTR)
+		LOG_ERROR("loop_wait(): epoll_wait()\n");
+	for (int i = 0; i < n; i++) {
+		if (evs[i].data.fd == signal_fd)
+			read_signals();
+		else
+			dispatch_fd(evs[i].data.fd);
+	}
+	wheel_advance(now_ms());
+}
+
+#else
+
+static void wait_timeout(int timeout) {
+	int n = poll(pollfds, nwatches + 1, timeout);
+	if (n < 0 && errno != EINTR)
+		LOG_ERROR("loop_wait(): poll()\n");
+	if (n > 0) {
+		if (pollfds[0].revents)
+			read_signals();
+		for (unsigned i = 1; i <= nwatches; i++) {
+			if (pollfds[i].revents)
+				dispatch_fd(pollfds[i].fd);
+		}
+	}
+	wheel_advance(now_ms());
+}
+
+#endif
+
+void loop_wait(void) {
+	wait_timeout(wheel_timeout(now_ms()));
+}
+
+void loop_poll(void) {
+	wait_timeout(0);
+}
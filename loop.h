@@ -0,0 +1,63 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Main loop multiplexing.
+//
+// The X connection is one file descriptor among any number watched by
+// loop_wait(), which also runs timers and dispatches signals.  Callbacks are
+// always called from loop_wait(), never from signal context, so they may do
+// anything.  The loop knows nothing of X itself: before waiting, the caller
+// should ensure output is flushed and no events are already queued by Xlib.
+//
+// Built with EPOLL, descriptors are watched with epoll and signals read
+// through a signalfd.  Otherwise, poll() is used, with signal handlers
+// writing to a pipe.
+//
+// Timers live on a hierarchical wheel with millisecond ticks: starting,
+// stopping and expiring a timer is constant time however many are pending.
+
+#ifndef EVILWM_LOOP_H_
+#define EVILWM_LOOP_H_
+
+#include <signal.h>
+#include <stdint.h>
+
+struct loop_timer {
+	struct loop_timer *next, **pprev;  // pprev is NULL if not pending
+	uint64_t expires;                  // tick (monotonic ms) due
+	void (*fn)(void *data);
+	void *data;
+};
+
+// Set up and shut down.  loop_init() must be called before registering
+// anything else.
+void loop_init(void);
+void loop_deinit(void);
+
+// Call fn(fd, data) whenever fd is readable.  A NULL fn just wakes the loop.
+void loop_watch_fd(int fd, void (*fn)(int fd, void *data), void *data);
+void loop_unwatch_fd(int fd);
+
+// Call fn(signo) on receipt of a signal.
+void loop_signal(int signo, void (*fn)(int signo));
+
+// Fill 'set' with the signals registered with loop_signal().  A child
+// process should have these restored to default disposition and unblocked.
+void loop_signals(sigset_t *set);
+
+// Timers.  Initialise once, then start (or restart) with a delay in
+// milliseconds.  Calls fn(data) once when it expires.
+void loop_timer_init(struct loop_timer *t, void (*fn)(void *), void *data);
+void loop_timer_start(struct loop_timer *t, unsigned ms);
+void loop_timer_stop(struct loop_timer *t);
+_Bool loop_timer_pending(const struct loop_timer *t);
+
+// Wait for any watched fd to become readable, a signal, or a timer to
+// expire, and dispatch callbacks for everything that's ready.
+void loop_wait(void);
+
+// As loop_wait(), but don't wait: just dispatch whatever is ready now.
+void loop_poll(void);
+
+#endif
@@ -23,6 +23,13 @@
 #include "evilwm.h"
 #include "list.h"
 #include "log.h"
+#include "loop.h"
+#include "screen.h"
+#ifdef STATS
+#include "stats.h"
+#endif
+#include "termpool.h"
+#include "util.h"
 #include "xalloc.h"
 #include "xconfig.h"
 
@@ -60,6 +67,7 @@ static void unset_solid_drag(void);
 static struct xconfig_option evilwm_options[] = {
 	{ XCONFIG_STRING,   "display",      { .s = &option.display } },
 	{ XCONFIG_STR_LIST, "term",         { .sl = &option.term } },
+	{ XCONFIG_INT,      "termpool",     { .i = &option.termpool } },
 #ifdef FONT
 	{ XCONFIG_STRING,   "fn",           { .s = &option.font } },
 #endif
@@ -74,16 +82,23 @@ static struct xconfig_option evilwm_options[] = {
 	{ XCONFIG_BOOL,     "wholescreen",  { .i = &option.wholescreen } },
 	{ XCONFIG_UINT,     "numvdesks",    { .u = &option.vdesks } },
 	{ XCONFIG_UINT,     "modvdesks",    { .u = &option.modvdesks } },
+	{ XCONFIG_BOOL,  "vdeskcontainers", { .i = &option.vdeskcontainers } },
 	{ XCONFIG_INT,      "docks",        { .i = &option.docks } },
 	{ XCONFIG_INT,     "soliddrag",     { .i = &option.solid_drag } },
 	{ XCONFIG_INT,     "solidsweep",    { .i = &option.solid_sweep } },
 	{ XCONFIG_CALL_0,   "nosoliddrag",  { .c0 = &unset_solid_drag } },
+	{ XCONFIG_STRING,   "outline",      { .s = &option.outline } },
+	{ XCONFIG_INT,      "framerate",    { .i = &option.framerate } },
+	{ XCONFIG_INT,      "focusdelay",   { .i = &option.focusdelay } },
 	{ XCONFIG_CALL_1,   "bind",         { .c1 = &set_bind } },
 	{ XCONFIG_BOOL,    "nodefaultbinds",{ .i = &option.nodefaultbinds } },
 	{ XCONFIG_CALL_1,   "mask",         { .c1 = &set_mask } },
 	{ XCONFIG_CALL_1,   "mask1",        { .c1 = &set_mask1 } },
 	{ XCONFIG_CALL_1,   "mask2",        { .c1 = &set_mask2 } },
 	{ XCONFIG_CALL_1,   "altmask",      { .c1 = &set_altmask } },
+#ifdef STATS
+	{ XCONFIG_STRING,   "statsfile",    { .s = &option.statsfile } },
+#endif
 
 	{ XCONFIG_CALL_1,   "app",          { .c1 = &set_app } },
 	{ XCONFIG_CALL_1,   "geometry",     { .c1 = &set_app_geometry } },
@@ -117,6 +132,7 @@ static void helptext(void) { puts(
 " Options:\n"
 "  --display DISPLAY   X display [from environment]\n"
 "  --term PROGRAM      command executed for --bind spawn [" DEF_TERM "]\n"
+"  --termpool N        keep N hidden terminals ready for spawn [" xstr(DEF_TERMPOOL) "]\n"
 #ifdef FONT
 "  --fn FONTNAME       X LFD for font used to display text [" DEF_FONT "]\n"
 #endif
@@ -131,9 +147,23 @@ static void helptext(void) { puts(
 "  --wholescreen       ignore monitor geometries when maximising\n"
 "  --numvdesks N       total number of virtual desktops [" xstr(DEF_VDESKS) "]\n"
 "  --modvdesks N       virtual desktop subdivision size; 0 means value of numvdesks [" xstr(DEF_VDESKSMOD) "]\n"
+"  --vdeskcontainers   switch vdesks by mapping one window per vdesk, not every client\n"
 "  --soliddrag N       nonzero to move the window directly rather than showing a placeholder [" xstr(DEF_SOLIDDRAG) "]\n"
 "  --solidsweep N      same but for resizing [" xstr(DEF_SOLIDSWEEP) "]\n"
 "  --nosoliddrag       alias for 'soliddrag 0'\n"
+"  --outline STYLE     placeholder for non-solid drags: window"
+#ifdef SHAPE_OUTLINE
+", shape"
+#endif
+#ifdef GC_INVERT
+", invert"
+#endif
+" [" DEF_OUTLINE "]\n"
+"  --framerate N       limit drag & sweep updates to N per second; 0 for no limit [" xstr(DEF_FRAMERATE) "]\n"
+"  --focusdelay MS     focus a window once the pointer rests in it this long [" xstr(DEF_FOCUSDELAY) "]\n"
+#ifdef STATS
+"  --statsfile FILE    append event loop statistics to FILE on SIGUSR1 [stderr]\n"
+#endif
 "\n"
 " Application matching options:\n"
 "  --app NAME/CLASS/WMNAME match application by WM_CLASS name & class + window title\n"
@@ -168,6 +198,7 @@ static void helptext(void) { puts(
 static const char *default_options[] = {
 	"display",
 	"term " DEF_TERM,
+	"termpool " xstr(DEF_TERMPOOL),
 	"fn " DEF_FONT,
 	"fg " DEF_FG,
 	"fc " DEF_FC,
@@ -181,8 +212,12 @@ static const char *default_options[] = {
 	"#wholescreen",
 	"numvdesks " xstr(DEF_VDESKS),
 	"modvdesks " xstr(DEF_VDESKSMOD),
+	"#vdeskcontainers",
 	"soliddrag " xstr(DEF_SOLIDDRAG),
 	"solidsweep " xstr(DEF_SOLIDSWEEP),
+	"outline " DEF_OUTLINE,
+	"framerate " xstr(DEF_FRAMERATE),
+	"focusdelay " xstr(DEF_FOCUSDELAY),
 	"mask1 " DEF_MASK1,
 	"mask2 " DEF_MASK2,
 	"altmask " DEF_ALTMASK,
@@ -199,19 +234,24 @@ int main(int argc, char *argv[]) {
 	int argn = 1, ret;
 	Window old_current_window = None;
 
-	struct sigaction act = {
-		.sa_handler = handle_signal,
-		.sa_flags = 0,
-	};
-	sigemptyset(&act.sa_mask);
-	sigaction(SIGTERM, &act, NULL);
-	sigaction(SIGINT, &act, NULL);
-	sigaction(SIGHUP, &act, NULL);
+	// Most signals are dispatched from the main loop
+	loop_init();
+	loop_signal(SIGTERM, handle_signal);
+	loop_signal(SIGINT, handle_signal);
+	loop_signal(SIGHUP, handle_signal);
+	loop_signal(SIGCHLD, reap_children);
+#ifdef STATS
+	loop_signal(SIGUSR1, stats_handle_signal);
+	loop_signal(SIGUSR2, stats_handle_signal);
+	stats_reset();
+#endif
+
+	// But not this one
 	struct sigaction segact = {
 		.sa_handler = handle_sigsegv,
-		.sa_flags = act.sa_flags,
-		.sa_mask = act.sa_mask,
+		.sa_flags = 0,
 	};
+	sigemptyset(&segact.sa_mask);
 	sigaction(SIGSEGV, &segact, NULL);
 
 	// Run until something signals to quit.
@@ -282,14 +322,22 @@ int main(int argc, char *argv[]) {
 			free(arg);
 		}
 
-		// Open display only if not already open
+		// Open display only if not already open.  Otherwise, bring
+		// grabs in line with any changed binds.
 		if (!display.dpy) {
 			display_open();
+		} else {
+			for (int i = 0; i < display.nscreens; i++)
+				bind_grab_for_screen(&display.screens[i]);
 		}
 
 		// Manage all eligible clients across all screens
 		display_manage_clients();
 
+		// Top up (or trim) the terminal pool
+		for (int i = 0; i < display.nscreens; i++)
+			termpool_fill(&display.screens[i]);
+
 		// Restore "old current window", if known
 		if (old_current_window != None) {
 			struct client *c = find_client(old_current_window);
@@ -322,12 +370,17 @@ int main(int argc, char *argv[]) {
 			free(app);
 		}
 
+		// Pooled terminals are kept across a reload, but not on exit
+		if (wm_exit)
+			termpool_deinit();
+
 		display_unmanage_clients();
 		XSync(display.dpy, True);
 	}
 
 	// Close display
 	display_close();
+	loop_deinit();
 
 	return 0;
 }
@@ -32,6 +32,11 @@
 #include "util.h"
 #include "xalloc.h"
 
+static void stack_containers(struct screen *s);
+#ifdef RANDR
+static void resize_timeout(void *data);
+#endif
+
 // Set up DISPLAY environment variable to use
 
 static char *screen_to_display_str(int i) {
@@ -87,7 +92,16 @@ void screen_init(struct screen *s) {
 	s->display = screen_to_display_str(i);
 
 	s->root = RootWindow(display.dpy, i);
+	s->mapping = (struct dlist)DLIST_INIT(struct client, mapping);
+	s->stacking = (struct dlist)DLIST_INIT(struct client, stacking);
+	s->client_list = (struct window_array){0};
+	s->client_list_written = 0;
+	s->stacking_list = (struct window_array){0};
+	s->desktops = (struct window_array){0};
+	s->monitors_serial = 0;
+	s->grid = (struct monitor_grid){0};
 #ifdef RANDR
+	loop_timer_init(&s->resize_timer, resize_timeout, s);
 	s->nmonitors = 0;
 	s->monitors = NULL;
         if (display.have_randr) {
@@ -106,6 +120,8 @@ void screen_init(struct screen *s) {
 	XAllocNamedColor(display.dpy, DefaultColormap(display.dpy, i), option.fg, &s->fg, &dummy);
 	XAllocNamedColor(display.dpy, DefaultColormap(display.dpy, i), option.bg, &s->bg, &dummy);
 	XAllocNamedColor(display.dpy, DefaultColormap(display.dpy, i), option.fc, &s->fc, &dummy);
+	for (int j = 0; j < 4; j++)
+		s->outline[j] = None;
 
 #ifdef GC_INVERT
 	// When dragging an outline, we use an inverting graphics context
@@ -138,10 +154,15 @@ void screen_init(struct screen *s) {
 	XChangeWindowAttributes(display.dpy, s->root, CWEventMask, &attr);
 
 	// Grab the various keyboard shortcuts
+	s->grabs = NULL;
 	bind_grab_for_screen(s);
 
 	s->active = None;
 	s->docks_visible = option.docks;
+	// Replace any client list left by a previous window manager
+	s->dirty = SCREEN_DIRTY_CLIENT_LIST;
+	s->containers = NULL;
+	s->ncontainers = 0;
 
 	Atom supported[] = {
 		X_ATOM(_NET_CLIENT_LIST),
@@ -182,6 +203,9 @@ void screen_init(struct screen *s) {
 		X_ATOM(_NET_WM_ACTION_CHANGE_DESKTOP),
 		X_ATOM(_NET_WM_ACTION_CLOSE),
 		X_ATOM(_NET_FRAME_EXTENTS),
+#ifdef XSYNC
+		X_ATOM(_NET_WM_SYNC_REQUEST),
+#endif
 	};
 
 	unsigned long num_desktops = option.vdesks;
@@ -230,7 +254,142 @@ void screen_deinit(struct screen *s) {
 	XDeleteProperty(display.dpy, s->root, X_ATOM(_NET_WORKAREA));
 	XDeleteProperty(display.dpy, s->root, X_ATOM(_NET_SUPPORTING_WM_CHECK));
 	XDestroyWindow(display.dpy, s->supporting);
+	for (int i = 0; i < 4; i++) {
+		if (s->outline[i] != None)
+			XDestroyWindow(display.dpy, s->outline[i]);
+		s->outline[i] = None;
+	}
+	screen_destroy_containers(s);
+#ifdef RANDR
+	loop_timer_stop(&s->resize_timer);
+#endif
 	free(s->monitors);
+	free(s->grid.x);
+	free(s->grid.y);
+	free(s->grid.cell);
+	s->grid = (struct monitor_grid){0};
+	free(s->client_list.w);
+	free(s->stacking_list.w);
+	free(s->desktops.w);
+	s->desktops = (struct window_array){0};
+	s->dirty = 0;
+	bind_forget_grabs(&s->grabs);
+}
+
+// Client list properties are marked dirty rather than written as clients
+// come, go or restack, so that a burst of events only rewrites them once.
+
+void screen_commit(struct screen *s) {
+	if (s->dirty & (SCREEN_DIRTY_CLIENT_LIST | SCREEN_DIRTY_CLIENT_LIST_APPEND))
+		ewmh_set_net_client_list(s);
+	if (s->dirty & SCREEN_DIRTY_CLIENT_LIST_STACKING)
+		ewmh_set_net_client_list_stacking(s);
+	s->dirty = 0;
+}
+
+// With the vdeskcontainers option, the frames of clients on each vdesk are
+// children of a screen-sized container window rather than of the root.
+// Only the current vdesk's container is mapped, so switching vdesk maps one
+// window and unmaps another, however many clients there are.  Containers
+// show the root's background, and are kept below everything else on the
+// root.
+
+Window screen_container(struct screen *s, unsigned v) {
+	if (v >= s->ncontainers) {
+		s->containers = xrealloc(s->containers, (v + 1) * sizeof(Window));
+		while (s->ncontainers <= v)
+			s->containers[s->ncontainers++] = None;
+	}
+	if (s->containers[v] == None) {
+		XSetWindowAttributes attr = {
+			.background_pixmap = ParentRelative,
+			.override_redirect = True,
+		};
+		Window w = XCreateWindow(display.dpy, s->root, 0, 0,
+		                         DisplayWidth(display.dpy, s->screen),
+		                         DisplayHeight(display.dpy, s->screen), 0,
+		                         CopyFromParent, InputOutput, CopyFromParent,
+		                         CWBackPixmap | CWOverrideRedirect, &attr);
+		s->containers[v] = w;
+		stack_containers(s);
+		if (v == s->vdesk)
+			XMapWindow(display.dpy, w);
+	}
+	return s->containers[v];
+}
+
+static void stack_containers(struct screen *s) {
+	static struct window_array a;
+	a.n = 0;
+	for (unsigned v = 0; v < s->ncontainers; v++) {
+		if (s->containers[v] != None)
+			window_array_add(&a, s->containers[v]);
+	}
+	if (!a.n)
+		return;
+	XLowerWindow(display.dpy, a.w[0]);
+	// The rest go directly below the first
+	if (a.n > 1)
+		XRestackWindows(display.dpy, a.w, a.n);
+}
+
+// Desktop windows (_NET_WM_WINDOW_TYPE_DESKTOP) are left unmanaged, and
+// typically cover the whole screen.  A container can't go above one without
+// hiding it and taking its input, nor below it without hiding the clients
+// inside, so containers aren't used while any desktop window is mapped.
+// Clients move out to the root when the first appears, and back when the
+// last goes.
+
+_Bool screen_uses_containers(struct screen *s) {
+	return option.vdeskcontainers && !s->desktops.n;
+}
+
+static void update_containers(struct screen *s) {
+	for (struct client *c = s->mapping.head; c; c = c->mapping.next)
+		client_update_container(c);
+	if (!screen_uses_containers(s))
+		screen_destroy_containers(s);
+}
+
+void screen_add_desktop(struct screen *s, Window w) {
+	for (unsigned i = 0; i < s->desktops.n; i++) {
+		if (s->desktops.w[i] == w)
+			return;
+	}
+	window_array_add(&s->desktops, w);
+	if (option.vdeskcontainers && s->desktops.n == 1)
+		update_containers(s);
+}
+
+void screen_remove_desktop(struct screen *s, Window w) {
+	for (unsigned i = 0; i < s->desktops.n; i++) {
+		if (s->desktops.w[i] == w) {
+			s->desktops.w[i] = s->desktops.w[--s->desktops.n];
+			if (option.vdeskcontainers && !s->desktops.n)
+				update_containers(s);
+			return;
+		}
+	}
+}
+
+void screen_destroy_containers(struct screen *s) {
+	for (unsigned v = 0; v < s->ncontainers; v++) {
+		if (s->containers[v] != None)
+			XDestroyWindow(display.dpy, s->containers[v]);
+	}
+	free(s->containers);
+	s->containers = NULL;
+	s->ncontainers = 0;
+}
+
+// Map the container for the new vdesk before unmapping the old, so the root
+// is never exposed in between.
+
+static void show_container(struct screen *s, unsigned old_v, unsigned v) {
+	if (v < option.vdesks)
+		XMapWindow(display.dpy, screen_container(s, v));
+	if (old_v < s->ncontainers && s->containers[old_v] != None)
+		XUnmapWindow(display.dpy, s->containers[old_v]);
 }
 
 // Switch virtual desktop.  Hides clients on different vdesks, shows clients on
@@ -243,10 +402,24 @@ void switch_vdesk(struct screen *s, unsigned v) {
 
 	LOG_ENTER("switch_vdesk(screen=%d, from=%u, to=%u)", s->screen, s->vdesk, v);
 
+	if (screen_uses_containers(s) && s->vdesk != VDESK_FIXED && v != VDESK_FIXED) {
+		s->old_vdesk = s->vdesk;
+		s->vdesk = v;
+		show_container(s, s->old_vdesk, v);
+		// Only clients not in a container (docks) are actually mapped
+		// or unmapped here.  The rest just need WM_STATE updating.
+		for (struct client *c = s->mapping.head; c; c = c->mapping.next) {
+			if (c->vdesk != s->old_vdesk && c->vdesk != v) continue;
+			if (is_visible(c)) client_show(c);
+			else client_hide(c);
+		}
+		ewmh_set_net_current_desktop(s);
+		LOG_LEAVE();
+		return;
+	}
+
 	// hide everything on old vdesk
-	for (struct list *iter = clients_tab_order; iter; iter = iter->next) {
-		struct client *c = iter->data;
-		if (c->screen != s) continue;
+	for (struct client *c = s->mapping.head; c; c = c->mapping.next) {
 		if (is_visible(c) && !is_fixed(c)) client_hide(c);
 	}
 
@@ -256,12 +429,14 @@ void switch_vdesk(struct screen *s, unsigned v) {
 	// Update current vdesk (including EWMH properties)
 	s->vdesk = v;
 
-	// show everything on vdesk
-	for (struct list *iter = clients_tab_order; iter; iter = iter->next) {
-		struct client *c = iter->data;
-		if (c->screen != s) continue;
+	// show everything on vdesk.  Showing all vdesks at once moves frames
+	// out of any containers, and back when leaving.
+	for (struct client *c = s->mapping.head; c; c = c->mapping.next) {
+		client_update_container(c);
 		if (is_visible(c) && !is_fixed(c)) client_show(c);
 	}
+	if (screen_uses_containers(s))
+		show_container(s, s->old_vdesk, v);
 
 	ewmh_set_net_current_desktop(s);
 
@@ -278,9 +453,7 @@ void set_docks_visible(struct screen *s, int is_visible) {
 	// Traverse client list and hide or show any docks on this screen as
 	// appropriate.
 
-	for (struct list *iter = clients_tab_order; iter; iter = iter->next) {
-		struct client *c = iter->data;
-		if (c->screen != s) continue;
+	for (struct client *c = s->mapping.head; c; c = c->mapping.next) {
 		if (c->is_dock) {
 			if (is_visible) {
 				// XXX I've assumed that if you want to see
@@ -298,6 +471,111 @@ void set_docks_visible(struct screen *s, int is_visible) {
 	LOG_LEAVE();
 }
 
+static int cmp_int(const void *a, const void *b) {
+	int ia = *(const int *)a, ib = *(const int *)b;
+	return (ia > ib) - (ia < ib);
+}
+
+// Sort an array of edges and remove duplicates.  Returns new length.
+
+static int unique_edges(int *edge, int n) {
+	qsort(edge, n, sizeof(int), cmp_int);
+	int u = 0;
+	for (int i = 0; i < n; i++) {
+		if (!u || edge[i] != edge[u-1])
+			edge[u++] = edge[i];
+	}
+	return u;
+}
+
+// Rebuild the monitor lookup grid.  There are at most 2n-1 columns and rows
+// for n monitors, and monitor counts are small, so a straightforward scan
+// per cell is fine: this only happens when the monitor layout changes.
+
+static void build_monitor_grid(struct screen *s) {
+	struct monitor_grid *g = &s->grid;
+	int nedges = 2 * s->nmonitors;
+	g->nx = g->ny = 0;
+	if (nedges < 2)
+		return;
+	g->x = xrealloc(g->x, nedges * sizeof(int));
+	g->y = xrealloc(g->y, nedges * sizeof(int));
+	for (int k = 0; k < s->nmonitors; k++) {
+		struct monitor *m = &s->monitors[k];
+		g->x[2*k] = m->x;
+		g->x[2*k+1] = m->x + m->width;
+		g->y[2*k] = m->y;
+		g->y[2*k+1] = m->y + m->height;
+	}
+	g->nx = unique_edges(g->x, nedges) - 1;
+	g->ny = unique_edges(g->y, nedges) - 1;
+	if (g->nx < 1 || g->ny < 1) {
+		g->nx = g->ny = 0;
+		return;
+	}
+	g->cell = xrealloc(g->cell, g->nx * g->ny * sizeof(int));
+	for (int j = 0; j < g->ny; j++) {
+		for (int i = 0; i < g->nx; i++) {
+			// Any point in the cell will do, so use its top left
+			int cx = g->x[i], cy = g->y[j];
+			int index = MONITOR_NONE;
+			for (int k = 0; k < s->nmonitors; k++) {
+				struct monitor *m = &s->monitors[k];
+				if (cx < m->x || cx >= m->x + m->width
+				    || cy < m->y || cy >= m->y + m->height)
+					continue;
+				index = (index == MONITOR_NONE) ? k : MONITOR_OVERLAP;
+			}
+			g->cell[j * g->nx + i] = index;
+		}
+	}
+}
+
+// Which of n cells between sorted edges contains v.  -1 if none.
+
+static int grid_find(const int *edge, int n, int v) {
+	if (n < 1 || v < edge[0] || v >= edge[n])
+		return -1;
+	int lo = 0, hi = n - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+		if (edge[mid] <= v)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	return lo;
+}
+
+int screen_monitor_covering(struct screen *s, int x1, int y1, int x2, int y2) {
+	struct monitor_grid *g = &s->grid;
+	int i1 = grid_find(g->x, g->nx, x1);
+	int i2 = grid_find(g->x, g->nx, x2 - 1);
+	int j1 = grid_find(g->y, g->ny, y1);
+	int j2 = grid_find(g->y, g->ny, y2 - 1);
+	if (i1 < 0 || i2 < 0 || j1 < 0 || j2 < 0)
+		return -1;
+	int index = g->cell[j1 * g->nx + i1];
+	if (index < 0)
+		return -1;
+	for (int j = j1; j <= j2; j++) {
+		for (int i = i1; i <= i2; i++) {
+			if (g->cell[j * g->nx + i] != index)
+				return -1;
+		}
+	}
+	return index;
+}
+
+// A new monitor layout invalidates any monitor cached by clients, and the
+// lookup grid.
+
+static void monitors_changed(struct screen *s) {
+	if (++s->monitors_serial == 0)
+		s->monitors_serial = 1;
+	build_monitor_grid(s);
+}
+
 // Get a list of monitors for the screen.  If Randr >= 1.5 is unavailable, or
 // the "wholescreen" option has been specified, assume a single monitor
 // covering the whole screen.
@@ -333,6 +611,7 @@ void screen_probe_monitors(struct screen *s) {
 			}
 			LOG_XLEAVE();
 			XRRFreeMonitors(monitors);
+			monitors_changed(s);
 			return;
 		}
 		LOG_XLEAVE();
@@ -348,6 +627,7 @@ void screen_probe_monitors(struct screen *s) {
 	s->monitors[0].width = DisplayWidth(display.dpy, s->screen);
 	s->monitors[0].height = DisplayHeight(display.dpy, s->screen);
 	s->monitors[0].area = s->monitors[0].width * s->monitors[0].height;
+	monitors_changed(s);
 }
 
 #ifdef RANDR
@@ -367,15 +647,36 @@ void screen_probe_monitors(struct screen *s) {
 //      proportional position within its nearest monitor
 //   4) adjust geometry of maximised clients to any "new" monitor
 
+// Docking or undocking tends to produce a burst of RandR notifications, each
+// of which would move every client.  Instead, wait for them to settle, then
+// fix up clients just once against the final monitor layout.  Until then,
+// the old monitor list (and so client_monitor()) stays in effect, so client
+// positions are still recorded relative to the monitors they were laid out
+// on.
+
+#define RESIZE_SETTLE_MS 100
+
+void screen_resize_later(struct screen *s) {
+	loop_timer_start(&s->resize_timer, RESIZE_SETTLE_MS);
+}
+
+static void resize_timeout(void *data) {
+	struct screen *s = data;
+	// Record geometries of clients relative to monitor
+	scan_clients_before_resize(s);
+	// Scan new monitor list
+	screen_probe_monitors(s);
+	// Fix any clients that are now not visible on any monitor.  Also
+	// adjusts maximised geometries where appropriate.
+	fix_screen_after_resize(s);
+	// Update various EWMH properties that reflect screen geometry
+	ewmh_set_screen_workarea(s);
+}
+
 // Record old monitor offset for each client before resize.
 
 void scan_clients_before_resize(struct screen *s) {
-	for (struct list *iter = clients_tab_order; iter; iter = iter->next) {
-		struct client *c = iter->data;
-		// only handle clients on the screen being resized
-		if (c->screen != s)
-			continue;
-
+	for (struct client *c = s->mapping.head; c; c = c->mapping.next) {
 		struct monitor *m = client_monitor(c, NULL);
 
 		int mw = m->width;
@@ -389,14 +690,19 @@ void scan_clients_before_resize(struct screen *s) {
 	}
 }
 
-// Fix up maximised and non-intersecting clients after resize.
+// Fix up maximised and non-intersecting clients after resize.  Clients
+// that end up where they were are left alone.
 
 void fix_screen_after_resize(struct screen *s) {
 	LOG_ENTER("fix_screen_after_resize(screen %i)",s->screen);
-	for (struct list *iter = clients_tab_order; iter; iter = iter->next) {
-		struct client *c = iter->data;
-		// only handle clients on the screen being resized
-		if (c->screen != s) continue;
+	// vdesk containers always cover the whole screen
+	for (unsigned v = 0; v < s->ncontainers; v++) {
+		if (s->containers[v] != None)
+			XResizeWindow(display.dpy, s->containers[v],
+			              DisplayWidth(display.dpy, s->screen),
+			              DisplayHeight(display.dpy, s->screen));
+	}
+	for (struct client *c = s->mapping.head; c; c = c->mapping.next) {
 		// Check for either: the monitor with a matching name, or just the closest monitor
 		struct monitor *m = NULL;
 		if (c->mon_name!=None) {
@@ -411,6 +717,7 @@ void fix_screen_after_resize(struct screen *s) {
 		LOG_DEBUG("w%lx: m%lx %s\n",c->window,c->mon_name,m?"✓":"✗");
 		Bool intersects = 0;
 		if (!m) m = client_monitor(c, &intersects);
+		int ox = c->x, oy = c->y, ow = c->width, oh = c->height;
 
 		if (c->oldw) {
 			// horiz maximised: update width, update old x pos
@@ -433,13 +740,24 @@ void fix_screen_after_resize(struct screen *s) {
 			if (!intersects)
 				c->y = m->y + c->mon_offy * m->height;
 		}
-		client_moveresize(c);
+		if (c->x != ox || c->y != oy || c->width != ow || c->height != oh)
+			client_moveresize(c);
 	}
 	LOG_LEAVE();
 }
 
 #endif
 
+// Append to an array of windows, growing it as needed.
+
+void window_array_add(struct window_array *a, Window w) {
+	if (a->n >= a->size) {
+		a->size = a->size ? a->size * 2 : 16;
+		a->w = xrealloc(a->w, a->size * sizeof(Window));
+	}
+	a->w[a->n++] = w;
+}
+
 // Find screen corresponding to specified root window.
 
 struct screen *find_screen(Window root) {
@@ -20,6 +20,11 @@
 #include <X11/extensions/Xrandr.h>
 #endif
 
+#include "list.h"
+#include "loop.h"
+
+struct grabset;
+
 struct monitor {
 	int x, y;
 	int width, height;
@@ -27,6 +32,31 @@ struct monitor {
 	Atom name;
 };
 
+// Monitor lookup grid.  The screen is cut into cells along every monitor
+// edge, so that each cell is either wholly covered by a monitor or not at all.
+// Each cell records which monitor covers it, or MONITOR_NONE, or
+// MONITOR_OVERLAP where monitors overlap.
+#define MONITOR_NONE    (-1)
+#define MONITOR_OVERLAP (-2)
+
+struct monitor_grid {
+	int nx, ny;  // columns, rows
+	int *x, *y;  // column and row edges, nx+1 and ny+1 of them
+	int *cell;   // nx*ny monitor indices, row by row
+};
+
+// Dirty flags: root window properties that are out of date and will be
+// rewritten by screen_commit()
+#define SCREEN_DIRTY_CLIENT_LIST          (1<<0)
+#define SCREEN_DIRTY_CLIENT_LIST_STACKING (1<<1)
+#define SCREEN_DIRTY_CLIENT_LIST_APPEND   (1<<2)  // only added to
+
+// A growable list of windows, eg to be written to a root window property
+struct window_array {
+	Window *w;
+	unsigned n, size;
+};
+
 struct screen {
 	int screen;          // screen index for display
 	char *display;       // DISPLAY string, eg ":0.0"
@@ -37,13 +67,38 @@ struct screen {
 	GC invert_gc;        // used to draw outlines
 #endif
 	XColor fg, bg, fc;   // allocated colours; active, inactive, fixed
+	Window outline[4];   // "window" style drag outline, created as needed
 	unsigned vdesk;      // current vdesk for screen
 	unsigned old_vdesk;  // previous vdesk, so user may toggle back to it
 	int docks_visible;   // docks can be toggled visible/hidden
+	unsigned dirty;      // root properties needing update (SCREEN_DIRTY_*)
+
+	// vdesk containers (--vdeskcontainers), created as needed, and the
+	// desktop windows that currently prevent their use
+	Window *containers;
+	unsigned ncontainers;
+	struct window_array desktops;
+	struct grabset *grabs;  // key & button grabs on root
+
+	// Clients on this screen, in the order they were mapped (head is
+	// eldest) and in stacking order (head is furthest back)
+	struct dlist mapping;
+	struct dlist stacking;
+
+	// _NET_CLIENT_LIST, of which the first client_list_written entries
+	// are known to be in the property, and _NET_CLIENT_LIST_STACKING
+	struct window_array client_list;
+	unsigned client_list_written;
+	struct window_array stacking_list;
 
 	// from randr, or just one entry with screen dimensions if no randr
 	int nmonitors;       // number of monitors
 	struct monitor *monitors;
+	unsigned monitors_serial;  // changes whenever monitors are probed
+	struct monitor_grid grid;
+#ifdef RANDR
+	struct loop_timer resize_timer;  // pending screen_resize_later()
+#endif
 };
 
 // Setup and shutdown.
@@ -53,12 +108,40 @@ void screen_deinit(struct screen *s);
 // Probe monitors (Randr)
 void screen_probe_monitors(struct screen *s);
 
+// Rewrite any root window properties flagged dirty.
+void screen_commit(struct screen *s);
+
 // Switch vdesks; hides & shows clients accordingly.
 void switch_vdesk(struct screen *s, unsigned v);
 
+// Container window for frames of clients on vdesk v, created if necessary.
+Window screen_container(struct screen *s, unsigned v);
+
+// Whether frames are parented to vdesk containers: only with the
+// vdeskcontainers option, and while no desktop window is mapped.
+_Bool screen_uses_containers(struct screen *s);
+
+// A desktop window (left unmanaged) has been mapped or unmapped.  While any
+// are mapped, frames are moved out of vdesk containers to the root.
+// screen_remove_desktop() ignores windows not previously added.
+void screen_add_desktop(struct screen *s, Window w);
+void screen_remove_desktop(struct screen *s, Window w);
+
+// Destroy all vdesk containers.  They must be empty.
+void screen_destroy_containers(struct screen *s);
+
 // Show or hide docks.
 void set_docks_visible(struct screen *s, int is_visible);
 
+// Index of the only monitor intersecting a rectangle (x2,y2 exclusive), if
+// the rectangle lies entirely within it.  Returns -1 otherwise, in which case
+// the caller must work it out the hard way.
+int screen_monitor_covering(struct screen *s, int x1, int y1, int x2, int y2);
+
+// The screen has been resized.  Once no further changes have arrived for a
+// short while, fix up clients to suit the new monitor layout.
+void screen_resize_later(struct screen *s);
+
 // Record old monitor size in each client before resize.
 void scan_clients_before_resize(struct screen *s);
 
@@ -72,6 +155,9 @@ struct screen *find_screen(Window root);
 // Find screen corresponding to the root window the pointer is currently on.
 struct screen *find_current_screen(void);
 
+// Append to a window array.
+void window_array_add(struct window_array *a, Window w);
+
 // Grab all the keys we're interested in for the specified screen.
 void grab_keys_for_screen(struct screen *s);
 
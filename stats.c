@@ -0,0 +1,132 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Event loop statistics
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <X11/X.h>
+
+#include "evilwm.h"
+#include "log.h"
+#include "stats.h"
+#include "util.h"
+
+#ifdef STATS
+
+// Core event types are < LASTEvent; extension events go up to 127
+#define STATS_NTYPES 128
+
+// Bucket n counts times of [2^(n-1), 2^n) microseconds (bucket 0 is under
+// 1us).  The last bucket collects anything longer.
+#define STATS_NBUCKETS 24
+
+struct histogram {
+	unsigned long count;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	unsigned long bucket[STATS_NBUCKETS];
+};
+
+static struct histogram event_hist[STATS_NTYPES];
+static struct histogram tidy_hist;
+static struct histogram spawn_hist;
+static uint64_t reset_time;
+
+static void record(struct histogram *h, uint64_t start) {
+	uint64_t ns = monotonic_ns() - start;
+	uint64_t us = ns / 1000;
+	unsigned b = 0;
+	while (us && b < STATS_NBUCKETS - 1) {
+		us >>= 1;
+		b++;
+	}
+	h->count++;
+	h->total_ns += ns;
+	if (ns > h->max_ns)
+		h->max_ns = ns;
+	h->bucket[b]++;
+}
+
+void stats_record_event(int type, uint64_t start) {
+	record(&event_hist[(unsigned)type % STATS_NTYPES], start);
+}
+
+void stats_record_tidy(uint64_t start) {
+	record(&tidy_hist, start);
+}
+
+void stats_record_spawn(uint64_t start) {
+	record(&spawn_hist, start);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void stats_handle_signal(int signo) {
+	if (signo == SIGUSR1) {
+		FILE *f = stderr;
+		if (option.statsfile && *option.statsfile) {
+			if (!(f = fopen(option.statsfile, "a"))) {
+				LOG_ERROR("can't open stats file '%s'\n", option.statsfile);
+				f = stderr;
+			}
+		}
+		stats_dump(f);
+		if (f != stderr)
+			fclose(f);
+		else
+			fflush(f);
+	} else if (signo == SIGUSR2) {
+		stats_reset();
+	}
+}
+
+// One line per histogram, as space-separated name=value.  Buckets are listed
+// as lower bound (in microseconds) and count, omitting empty ones.
+
+static void dump_histogram(FILE *f, const char *what, const struct histogram *h) {
+	fprintf(f, "stats %s count=%lu mean_us=%.1f max_us=%.1f hist_us=", what,
+	        h->count, h->count ? (double)h->total_ns / h->count / 1e3 : 0.,
+	        (double)h->max_ns / 1e3);
+	const char *sep = "";
+	for (unsigned b = 0; b < STATS_NBUCKETS; b++) {
+		if (!h->bucket[b])
+			continue;
+		fprintf(f, "%s%lu:%lu", sep, b ? 1UL << (b - 1) : 0UL, h->bucket[b]);
+		sep = ",";
+	}
+	fprintf(f, "\n");
+}
+
+void stats_dump(FILE *f) {
+	char what[48];
+	fprintf(f, "stats period_s=%.3f\n", (double)(monotonic_ns() - reset_time) / 1e9);
+	for (unsigned type = 0; type < STATS_NTYPES; type++) {
+		if (!event_hist[type].count)
+			continue;
+		if (type < LASTEvent)
+			snprintf(what, sizeof(what), "event=%s", xevent_string(type));
+		else
+			snprintf(what, sizeof(what), "event=%u", type);
+		dump_histogram(f, what, &event_hist[type]);
+	}
+	dump_histogram(f, "tidy", &tidy_hist);
+	dump_histogram(f, "spawn", &spawn_hist);
+}
+
+void stats_reset(void) {
+	memset(event_hist, 0, sizeof(event_hist));
+	memset(&tidy_hist, 0, sizeof(tidy_hist));
+	memset(&spawn_hist, 0, sizeof(spawn_hist));
+	reset_time = monotonic_ns();
+}
+
+#endif
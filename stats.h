@@ -0,0 +1,33 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Event loop statistics.
+//
+// Counts events handled by type, with a histogram of how long each took in
+// power-of-two microsecond buckets, so that input lag can be pinned on (or
+// ruled out for) the window manager.  Client list tidy passes get their own
+// histogram, as does the time taken to spawn a process.  SIGUSR1 dumps
+// everything to stderr, or to the file named by the "statsfile" option;
+// SIGUSR2 resets it.  Signals are dispatched from
+// the main loop (see loop.h), so are handled as soon as they arrive.
+
+#ifndef EVILWM_STATS_H_
+#define EVILWM_STATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Record time taken since 'start' (from monotonic_ns()) to handle an event, a tidy pass, or to
+// spawn a process
+void stats_record_event(int type, uint64_t start);
+void stats_record_tidy(uint64_t start);
+void stats_record_spawn(uint64_t start);
+
+// Main loop signal callback for SIGUSR1 (dump) & SIGUSR2 (reset)
+void stats_handle_signal(int signo);
+
+void stats_dump(FILE *f);
+void stats_reset(void);
+
+#endif
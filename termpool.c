@@ -0,0 +1,160 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Pre-spawned terminal pool
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include <X11/X.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+
+#include "client.h"
+#include "display.h"
+#include "evilwm.h"
+#include "ewmh.h"
+#include "list.h"
+#include "log.h"
+#include "screen.h"
+#include "termpool.h"
+#include "util.h"
+#include "winprops.h"
+#include "xalloc.h"
+
+// A terminal we spawned for the pool.  Until its window is adopted, client
+// is NULL.
+
+struct pool_term {
+	pid_t pid;
+	struct screen *screen;
+	struct client *client;
+};
+
+static struct list *pool = NULL;
+
+static void pool_drop(struct pool_term *t) {
+	pool = list_delete(pool, t);
+	free(t);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void termpool_fill(struct screen *s) {
+	unsigned want = option.termpool > 0 ? option.termpool : 0;
+	unsigned have = 0;
+	struct list *iter = pool;
+	while (iter) {
+		struct pool_term *t = iter->data;
+		iter = iter->next;
+		if (t->screen != s)
+			continue;
+		if (have < want) {
+			have++;
+			continue;
+		}
+		LOG_DEBUG("termpool: killing excess terminal pid=%ld\n", (long)t->pid);
+		kill(t->pid, SIGTERM);
+		pool_drop(t);
+	}
+	for (; have < want; have++) {
+		pid_t pid = spawn(s, (const char *const *)option.term);
+		if (pid <= 0)
+			break;
+		struct pool_term *t = xmalloc(sizeof(*t));
+		*t = (struct pool_term){ .pid = pid, .screen = s };
+		pool = list_append(pool, t);
+		LOG_DEBUG("termpool: spawned pid=%ld\n", (long)pid);
+	}
+}
+
+_Bool termpool_adopt(struct client *c, struct winprops *wp) {
+	if (!pool)
+		return 0;
+	unsigned long nitems;
+	unsigned long *pid = winprops_get(wp, WINPROP_NET_WM_PID, XA_CARDINAL, &nitems);
+	if (!pid || nitems < 1)
+		return 0;
+	for (struct list *iter = pool; iter; iter = iter->next) {
+		struct pool_term *t = iter->data;
+		if (t->client || t->screen != c->screen || (unsigned long)t->pid != pid[0])
+			continue;
+		LOG_DEBUG("termpool: adopted window=%lx pid=%ld\n", (unsigned long)c->window, (long)t->pid);
+		t->client = c;
+		c->vdesk = VDESK_POOL;
+		return 1;
+	}
+	return 0;
+}
+
+struct client *termpool_take(struct screen *s, int x, int y) {
+	struct list *iter = pool;
+	while (iter) {
+		struct pool_term *t = iter->data;
+		iter = iter->next;
+		struct client *c = t->client;
+		if (t->screen != s || !c)
+			continue;
+		pool_drop(t);
+		// Anything that moved it off the pool vdesk made it an
+		// ordinary window, so it can't be handed out.
+		if (c->vdesk != VDESK_POOL)
+			continue;
+
+		// Position as if newly mapped with the pointer at (x,y)
+		client_place_at_pointer(c, x, y);
+		client_replace_border(c);
+		client_moveresize(c);
+
+		// Now it counts as mapped
+		dlist_to_tail(&s->mapping, c);
+		ewmh_client_list_add(c);
+		s->dirty |= SCREEN_DIRTY_CLIENT_LIST_STACKING;
+
+		client_to_vdesk(c, s->vdesk);
+		client_raise(c);
+		client_select(c);
+#ifdef WARP_POINTER
+		setmouse(c->window, c->width + c->border - 1, c->height + c->border - 1);
+#endif
+		return c;
+	}
+	return NULL;
+}
+
+void termpool_forget(struct client *c) {
+	for (struct list *iter = pool; iter; iter = iter->next) {
+		struct pool_term *t = iter->data;
+		if (t->client != c)
+			continue;
+		if (c->remove)
+			pool_drop(t);
+		else
+			t->client = NULL;
+		return;
+	}
+}
+
+void termpool_exited(pid_t pid) {
+	for (struct list *iter = pool; iter; iter = iter->next) {
+		struct pool_term *t = iter->data;
+		if (t->pid == pid) {
+			pool_drop(t);
+			return;
+		}
+	}
+}
+
+void termpool_deinit(void) {
+	while (pool) {
+		struct pool_term *t = pool->data;
+		kill(t->pid, SIGTERM);
+		pool_drop(t);
+	}
+}
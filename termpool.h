@@ -0,0 +1,48 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Pre-spawned terminal pool.
+//
+// With the "termpool" option set to N, N instances of the terminal are kept
+// running for each screen, managed but hidden on a vdesk of their own
+// (VDESK_POOL).  The spawn binding then just moves one to the current vdesk
+// and starts a replacement, rather than waiting for a new terminal to start
+// up.  Pool windows are recognised by _NET_WM_PID, so the terminal must set
+// that on its own window: xterm does, but terminals that hand off to a
+// server process won't be matched.
+
+#ifndef EVILWM_TERMPOOL_H_
+#define EVILWM_TERMPOOL_H_
+
+#include <sys/types.h>
+
+struct client;
+struct screen;
+struct winprops;
+
+// Spawn terminals until the pool for a screen is full (or kill any in
+// excess of the "termpool" option).
+void termpool_fill(struct screen *s);
+
+// Called while managing a new client.  If the window belongs to a pooled
+// terminal, place it on VDESK_POOL and return true.
+_Bool termpool_adopt(struct client *c, struct winprops *wp);
+
+// Take a ready terminal from the pool for a screen, show it on the current
+// vdesk positioned relative to pointer position (x,y), and select it.
+// Returns NULL if none is ready.
+struct client *termpool_take(struct screen *s, int x, int y);
+
+// Client is being removed.  If it was withdrawn, it leaves the pool.  If
+// the window manager is just unmanaging everything, it will be adopted
+// again when remanaged.
+void termpool_forget(struct client *c);
+
+// A child process has exited; drop it from the pool.
+void termpool_exited(pid_t pid);
+
+// Kill all pooled terminals.
+void termpool_deinit(void);
+
+#endif
@@ -9,10 +9,14 @@
 #endif
 
 #include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/select.h>
 #include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <X11/X.h>
@@ -24,41 +28,147 @@
 #include "events.h"
 #include "evilwm.h"
 #include "log.h"
+#include "loop.h"
 #include "screen.h"
+#ifdef STATS
+#include "stats.h"
+#endif
+#include "termpool.h"
 #include "util.h"
+#include "xalloc.h"
+
+// Error handler interaction: ranges of request serial numbers for which
+// errors are expected.  The last serial of a range is 0 until it's closed.
+
+struct xerror_range {
+	unsigned long first, last;
+	Window w;  // for debugging
+};
+
+static struct xerror_range *xerror_ranges = NULL;
+static unsigned xerror_nranges = 0;
+
+// Errors arrive in request order, so once the server is known to have
+// processed a closed range's last request, any errors it raised have been
+// handled.
+
+static void xerror_expire(void) {
+	unsigned long processed = LastKnownRequestProcessed(display.dpy);
+	unsigned n = 0;
+	for (unsigned i = 0; i < xerror_nranges; i++) {
+		struct xerror_range *r = &xerror_ranges[i];
+		if (r->last && r->last <= processed)
+			continue;
+		xerror_ranges[n++] = *r;
+	}
+	xerror_nranges = n;
+}
+
+void xerror_ignore_begin(Window w) {
+	xerror_expire();
+	xerror_ranges = xrealloc(xerror_ranges, (xerror_nranges + 1) * sizeof(*xerror_ranges));
+	xerror_ranges[xerror_nranges++] = (struct xerror_range){
+		.first = NextRequest(display.dpy), .w = w
+	};
+}
 
-// For get_property()
-#define MAXIMUM_PROPERTY_LENGTH 4096
+void xerror_ignore_end(void) {
+	unsigned long last = NextRequest(display.dpy) - 1;
+	for (unsigned i = xerror_nranges; i > 0; i--) {
+		struct xerror_range *r = &xerror_ranges[i-1];
+		if (r->last)
+			continue;
+		if (last < r->first) {
+			// No requests made: forget it
+			xerror_ranges[i-1] = xerror_ranges[--xerror_nranges];
+		} else {
+			r->last = last;
+		}
+		return;
+	}
+}
+
+static struct xerror_range *xerror_find(unsigned long serial) {
+	for (unsigned i = 0; i < xerror_nranges; i++) {
+		struct xerror_range *r = &xerror_ranges[i];
+		if (serial >= r->first && (!r->last || serial <= r->last))
+			return r;
+	}
+	return NULL;
+}
 
-// Error handler interaction
-volatile Window initialising = None;
-volatile Window removing = None;
-volatile Window removing_parent = None;
+// Spawn a subprocess with posix_spawnp(), which returns as soon as the child
+// has exec()ed - nothing waits for it to exit.  Children are reaped by
+// reap_children() on SIGCHLD.  DISPLAY is set to the screen's display in an
+// environment built just for the child, leaving our own untouched.
 
-// Spawn a subprocess by fork()ing twice so we don't have to worry about
-// SIGCHLDs.
+extern char **environ;
 
-void spawn(const char *const cmd[]) {
-	struct screen *current_screen = find_current_screen();
+pid_t spawn(struct screen *s, const char *const cmd[]) {
+#ifdef STATS
+	uint64_t start = monotonic_ns();
+#endif
+	if (!s)
+		s = find_current_screen();
+
+	// Copy the environment, replacing (or adding) DISPLAY
+	size_t nenv = 0;
+	while (environ[nenv])
+		nenv++;
+	char **envp = xmalloc((nenv + 2) * sizeof(*envp));
+	size_t n = 0;
+	for (size_t i = 0; i < nenv; i++) {
+		if (s && s->display && strncmp(environ[i], "DISPLAY=", 8) == 0)
+			continue;
+		envp[n++] = environ[i];
+	}
+	if (s && s->display)
+		envp[n++] = s->display;
+	envp[n] = NULL;
+
+	// Child gets default handling for the signals the main loop
+	// handles, none blocked, and a session (or at least a process
+	// group) of its own.
+	posix_spawnattr_t attr;
+	sigset_t sigdef, sigmask;
+	short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+#ifdef POSIX_SPAWN_SETSID
+	flags |= POSIX_SPAWN_SETSID;
+#else
+	flags |= POSIX_SPAWN_SETPGROUP;
+#endif
+	loop_signals(&sigdef);
+	sigemptyset(&sigmask);
+	posix_spawnattr_init(&attr);
+	posix_spawnattr_setflags(&attr, flags);
+	posix_spawnattr_setsigdefault(&attr, &sigdef);
+	posix_spawnattr_setsigmask(&attr, &sigmask);
+
+	// posix_spawnp()'s prototype is (char *const *) suggesting that it
+	// modifies the contents of the strings.  The prototype is this way
+	// due to SUS maintaining compatability with older code.  However,
+	// it is guaranteed not to modify argv, so the following cast is
+	// valid.
 	pid_t pid;
-
-	if (current_screen && current_screen->display)
-		putenv(current_screen->display);
-	if (!(pid = fork())) {
-		// Put first fork in a new session
-		setsid();
-		switch (fork()) {
-			// execvp()'s prototype is (char *const *) suggesting that it
-			// modifies the contents of the strings.  The prototype is this
-			// way due to SUS maintaining compatability with older code.
-			// However, execvp guarantees not to modify argv, so the following
-			// cast is valid.
-			case 0: execvp(cmd[0], (char *const *)cmd); break;
-			default: _exit(0);
-		}
+	int err = posix_spawnp(&pid, cmd[0], NULL, &attr, (char *const *)cmd, envp);
+	if (err) {
+		LOG_ERROR("failed to spawn '%s': %s\n", cmd[0], strerror(err));
+		pid = -1;
 	}
-	if (pid > 0)
-		wait(NULL);
+
+	posix_spawnattr_destroy(&attr);
+	free(envp);
+#ifdef STATS
+	stats_record_spawn(start);
+#endif
+	return pid;
+}
+
+void reap_children(int signo) {
+	(void)signo;
+	pid_t pid;
+	while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+		termpool_exited(pid);
 }
 
 // When something we do raises an X error, we get sent here.  There are several
@@ -73,31 +183,22 @@ int handle_xerror(Display *dsply, XErrorEvent *e) {
 	if (  XGetErrorText( display.dpy, e->error_code, buf, sizeof(buf)/sizeof(buf[0]) )  )
 		buf[0]=0;
 
-	if(e->resourceid==0){
-		LOG_ERROR("0 resourceid on xerror!\n");
-		return 0;
-	}
-
-	// Some parts of the code deliberately disable error checking.
-
-	// client_manage_new() sets initialising to non-None to test if a
-	// window still exists.  If we end up here, the test failed, so
-	// indicate that by setting it back to None.
+	// Some parts of the code deliberately disable error checking, as
+	// the window they're operating on may have been destroyed at any
+	// time (eg while adopting or removing a client).  The request's
+	// serial number identifies them.
 
-	if (e->resourceid == initialising) {
-		LOG_XDEBUG("error caught while initialising window=%lx\n", (unsigned long)initialising);
-		initialising = None;
-		// LOG_LEAVE();
+	struct xerror_range *r = xerror_find(e->serial);
+	if (r) {
+		LOG_XDEBUG("error caught for window=%lx serial=%lu\n", (unsigned long)r->w, e->serial);
 		return 0;
 	}
 
-	// same in client_remove()
-	if (e->resourceid == removing || e->resourceid == removing_parent) {
-		LOG_XDEBUG("error caught while removing window=%lx\n", (unsigned long)removing);
-		// removing = None;
-		// LOG_LEAVE();
+	if(e->resourceid==0){
+		LOG_ERROR("0 resourceid on xerror!\n");
 		return 0;
 	}
+
 	LOG_ENTER("handle_xerror(error=%d \x1b[31m%s\x1b[0m, request=%d/%d, resourceid=%lx)",
 		e->error_code, buf, e->request_code, e->minor_code, e->resourceid);
 
@@ -125,8 +226,7 @@ int handle_xerror(Display *dsply, XErrorEvent *e) {
 	c = find_client(e->resourceid);
 	if (c) {
 		LOG_DEBUG("flagging client for removal\n");
-		c->remove = 1;
-		need_client_tidy = 1;
+		client_remove_later(c);
 	} else {
 		LOG_DEBUG("unknown error: not handling\n");
 	}
@@ -172,52 +272,57 @@ void *get_property(Window w, Atom property, Atom req_type,
 // only way clients can signal they don't want a border.
 
 int window_normal_border(Window w) {
-	int bw = option.bw;
 	PropMwmHints *mprop;
 	unsigned long nitems;
+	int bw = option.bw;
 	if ( (mprop = get_property(w, X_ATOM(_MOTIF_WM_HINTS), X_ATOM(_MOTIF_WM_HINTS), &nitems)) ) {
-		if (nitems >= PROP_MWM_HINTS_ELEMENTS
-		    && (mprop->flags & MWM_HINTS_DECORATIONS)
-		    && !(mprop->decorations & MWM_DECOR_ALL)
-		    && !(mprop->decorations & MWM_DECOR_BORDER)) {
-			bw = 0;
-		}
+		bw = mwm_hints_normal_border(mprop, nitems);
 		XFree(mprop);
 	}
 	return bw;
 }
 
+// Same, given already-fetched hints.
+
+int mwm_hints_normal_border(const PropMwmHints *mprop, unsigned long nitems) {
+	if (nitems >= PROP_MWM_HINTS_ELEMENTS
+	    && (mprop->flags & MWM_HINTS_DECORATIONS)
+	    && !(mprop->decorations & MWM_DECOR_ALL)
+	    && !(mprop->decorations & MWM_DECOR_BORDER)) {
+		return 0;
+	}
+	return option.bw;
+}
 
-// interruptibleXNextEvent() is taken from the Blender source and comes with
-// the following copyright notice:
-//
-// Copyright (c) Mark J. Kilgard, 1994, 1995, 1996.
-//
-// This program is freely distributable without licensing fees and is provided
-// without guarantee or warrantee expressed or implied. This program is -not-
-// in the public domain.
+// Monotonic clock.  Everything that times anything uses this.
 
-// Unlike XNextEvent, if a signal arrives, interruptibleXNextEvent will return
-// zero.
+uint64_t monotonic_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
 
-int interruptibleXNextEvent(XEvent *event) {
+int timedXIfEvent(XEvent *event, Bool (*predicate)(Display *, XEvent *, XPointer),
+                  XPointer arg, uint64_t deadline) {
 	fd_set fds;
-	int rc;
 	int dpy_fd = ConnectionNumber(display.dpy);
 	for (;;) {
-		if (XPending(display.dpy)) {
-			XNextEvent(display.dpy, event);
+		// Flushes output and reads whatever is available first
+		if (XCheckIfEvent(display.dpy, event, predicate, arg))
 			return 1;
-		}
+		uint64_t now = monotonic_ns();
+		if (now >= deadline)
+			return 0;
+		uint64_t left_us = (deadline - now + 999) / 1000;
+		struct timeval tv = {
+			.tv_sec = left_us / 1000000,
+			.tv_usec = left_us % 1000000,
+		};
 		FD_ZERO(&fds);
 		FD_SET(dpy_fd, &fds);
-		rc = select(dpy_fd + 1, &fds, NULL, NULL, NULL);
-		if (rc < 0) {
-			if (errno == EINTR) {
-				return 0;
-			} else {
-				LOG_ERROR("interruptibleXNextEvent(): select()\n");
-			}
+		if (select(dpy_fd + 1, &fds, NULL, NULL, &tv) < 0 && errno != EINTR) {
+			LOG_ERROR("timedXIfEvent(): select()\n");
+			return 0;
 		}
 	}
 }
@@ -229,11 +334,13 @@ int interruptibleXNextEvent(XEvent *event) {
 ||  defined(CONFIGURECURRENT_DISCARDENTERS) \
 ||  defined(NEXT_DISCARDENTERS)
 // Remove enter events from the queue, preserving only the last one
-// corresponding to "except"s parent.
+// corresponding to "except"s parent.  Any pending restack is sent first, so
+// that the enter events it causes are discarded too.
 
 void discard_enter_events(struct client *except) {
 	XEvent tmp, putback_ev;
 	int putback = 0;
+	client_commit_stacking();
 	XSync(display.dpy, False);
 	while (XCheckMaskEvent(display.dpy, EnterWindowMask, &tmp)) {
 		if (tmp.xcrossing.window == except->parent) {
@@ -5,10 +5,19 @@
 #ifndef EVILWM_UTIL_H_
 #define EVILWM_UTIL_H_
 
+#include <stdint.h>
+#include <sys/types.h>
+
 #include <X11/Xlib.h>
 
 #include "log.h"
 
+struct client;
+struct screen;
+
+// Limit on property data requested by get_property() and friends
+#define MAXIMUM_PROPERTY_LENGTH 4096
+
 // Required for interpreting MWM hints
 
 #define PROP_MWM_HINTS_ELEMENTS 3
@@ -41,13 +50,20 @@ typedef struct {
 #define setmouse(w, x, y) XWarpPointer(display.dpy, None, w, 0, 0, 0, 0, x, y)
 // #endif
 
-// Error handler interaction
-extern volatile Window initialising;
-extern volatile Window removing;
-extern volatile Window removing_parent;
+// Error handler interaction.  Errors raised by requests made between these
+// calls are expected, and ignored.  Request serial numbers are recorded, so
+// nothing has to wait for the server: errors are attributed correctly
+// whenever they arrive.  May be nested.
+void xerror_ignore_begin(Window w);
+void xerror_ignore_end(void);
 
-// Spawn a subprocess (usually xterm or similar)
-void spawn(const char *const cmd[]);
+// Spawn a subprocess (usually xterm or similar) on screen 's' (if NULL, the
+// screen the pointer is on).  Doesn't wait for it.  Returns its pid, or -1
+// on failure.
+pid_t spawn(struct screen *s, const char *const cmd[]);
+
+// Main loop SIGCHLD callback: reap any exited children
+void reap_children(int signo);
 
 // Global X11 error handler.  Various actions interact with this.
 int handle_xerror(Display *dsply, XErrorEvent *e);
@@ -60,10 +76,15 @@ void *get_property(Window w, Atom property, Atom req_type, unsigned long *nitems
 
 // Determine the normal border size for a window.
 int window_normal_border(Window w);
+int mwm_hints_normal_border(const PropMwmHints *mprop, unsigned long nitems);
+
+// Monotonic clock in nanoseconds
+uint64_t monotonic_ns(void);
 
-// Alternative to XNextEvent().  Unlike XNextEvent, if a signal arrives,
-// interruptibleXNextEvent will return zero.
-int interruptibleXNextEvent(XEvent *event);
+// As XIfEvent(), but gives up and returns zero once monotonic_ns() reaches
+// deadline.
+int timedXIfEvent(XEvent *event, Bool (*predicate)(Display *, XEvent *, XPointer),
+                  XPointer arg, uint64_t deadline);
 
 #if defined(MAXIMIZE_DISCARDENTERS) \
 ||  defined(MOVERESIZE_DISCARDENTERS) \
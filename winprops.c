@@ -0,0 +1,300 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Window property prefetch
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <X11/X.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#ifdef XCB
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
+#endif
+
+#include "display.h"
+#include "log.h"
+#include "util.h"
+#include "winprops.h"
+
+// Element counts of WM_NORMAL_HINTS before and after ICCCM version 1
+#define OLD_NUM_PROP_SIZE_ELEMENTS 15
+#define NUM_PROP_SIZE_ELEMENTS 18
+
+static Atom winprop_atom(int prop) {
+	switch (prop) {
+	case WINPROP_WM_NAME: return XA_WM_NAME;
+	case WINPROP_WM_CLASS: return XA_WM_CLASS;
+	case WINPROP_WM_NORMAL_HINTS: return XA_WM_NORMAL_HINTS;
+	case WINPROP_MOTIF_WM_HINTS: return X_ATOM(_MOTIF_WM_HINTS);
+	case WINPROP_NET_WM_WINDOW_TYPE: return X_ATOM(_NET_WM_WINDOW_TYPE);
+	case WINPROP_NET_WM_DESKTOP: return X_ATOM(_NET_WM_DESKTOP);
+	case WINPROP_NET_WM_PID: return X_ATOM(_NET_WM_PID);
+	case WINPROP_EVILWM_UNMAXIMISED_HORZ: return X_ATOM(_EVILWM_UNMAXIMISED_HORZ);
+	case WINPROP_EVILWM_UNMAXIMISED_VERT: return X_ATOM(_EVILWM_UNMAXIMISED_VERT);
+	default: break;
+	}
+	return None;
+}
+
+void winprops_init(struct winprops *wp, Window w) {
+	*wp = (struct winprops){0};
+	wp->w = w;
+#ifdef TRACE
+	wp->trace_time = monotonic_ns();
+#endif
+}
+
+#ifdef XCB
+
+// With XCB, requests are sent immediately and replies are read back as they
+// are collected.  Errors are returned with the reply rather than through the
+// Xlib error handler.
+
+// XCB returns cookies by value; that's fine.
+#pragma GCC diagnostic ignored "-Waggregate-return"
+
+void winprops_request(struct winprops *wp, unsigned what) {
+	xcb_connection_t *conn = XGetXCBConnection(display.dpy);
+	what &= ~wp->pending;
+	if (what & WINPROPS_ATTR) {
+		wp->attr_cookie = xcb_get_window_attributes(conn, wp->w);
+		wp->geom_cookie = xcb_get_geometry(conn, wp->w);
+	}
+	if (what & WINPROPS_PROPS) {
+		for (int i = 0; i < NUM_WINPROPS; i++) {
+			wp->prop_cookie[i] = xcb_get_property(conn, 0, wp->w,
+			                        winprop_atom(i), XCB_GET_PROPERTY_TYPE_ANY,
+			                        0, MAXIMUM_PROPERTY_LENGTH / 4);
+		}
+	}
+	if (what & WINPROPS_POINTER) {
+		wp->pointer_cookie = xcb_query_pointer(conn, wp->w);
+	}
+	wp->pending |= what;
+}
+
+// Convert XCB property value to the layout Xlib would return.
+
+static void set_prop(struct winprop *p, xcb_get_property_reply_t *r) {
+	unsigned long nitems = r->value_len;
+	size_t size = (r->format == 32) ? sizeof(long) : (r->format == 16) ? sizeof(short) : 1;
+	void *value = xcb_get_property_value(r);
+	char *data = malloc((nitems + 1) * size);
+	if (!data)
+		return;
+	if (r->format == 32) {
+		long *ldata = (long *)data;
+		for (unsigned long i = 0; i < nitems; i++)
+			ldata[i] = ((int32_t *)value)[i];  // Xlib sign extends too
+	} else {
+		memcpy(data, value, nitems * size);
+	}
+	memset(data + nitems * size, 0, size);
+	p->type = r->type;
+	p->format = r->format;
+	p->nitems = nitems;
+	p->data = data;
+}
+
+void winprops_collect(struct winprops *wp) {
+	xcb_connection_t *conn = XGetXCBConnection(display.dpy);
+	xcb_generic_error_t *err = NULL;
+
+	LOG_XENTER("winprops_collect(window=%lx)", (unsigned long)wp->w);
+	if (wp->pending & WINPROPS_ATTR) {
+		xcb_get_window_attributes_reply_t *ar;
+		xcb_get_geometry_reply_t *gr;
+		ar = xcb_get_window_attributes_reply(conn, wp->attr_cookie, &err);
+		free(err);
+		gr = xcb_get_geometry_reply(conn, wp->geom_cookie, &err);
+		free(err);
+		if (ar && gr) {
+			wp->attr.x = gr->x;
+			wp->attr.y = gr->y;
+			wp->attr.width = gr->width;
+			wp->attr.height = gr->height;
+			wp->attr.border_width = gr->border_width;
+			wp->attr.depth = gr->depth;
+			wp->attr.root = gr->root;
+			wp->attr.class = ar->_class;
+			wp->attr.map_state = ar->map_state;
+			wp->attr.override_redirect = ar->override_redirect;
+			wp->attr.colormap = ar->colormap;
+			wp->valid |= WINPROPS_ATTR;
+			debug_window_attributes(&wp->attr);
+		}
+		free(ar);
+		free(gr);
+	}
+	if (wp->pending & WINPROPS_PROPS) {
+		for (int i = 0; i < NUM_WINPROPS; i++) {
+			xcb_get_property_reply_t *r;
+			r = xcb_get_property_reply(conn, wp->prop_cookie[i], &err);
+			free(err);
+			if (r && r->type != XCB_ATOM_NONE)
+				set_prop(&wp->prop[i], r);
+			free(r);
+		}
+		wp->valid |= WINPROPS_PROPS;
+	}
+	if (wp->pending & WINPROPS_POINTER) {
+		xcb_query_pointer_reply_t *r;
+		r = xcb_query_pointer_reply(conn, wp->pointer_cookie, &err);
+		free(err);
+		if (r) {
+			wp->pointer_x = r->root_x;
+			wp->pointer_y = r->root_y;
+			wp->pointer_same_screen = r->same_screen;
+			wp->valid |= WINPROPS_POINTER;
+		}
+		free(r);
+	}
+	wp->pending = 0;
+	LOG_XLEAVE();
+}
+
+void winprops_free(struct winprops *wp) {
+	if (wp->pending)
+		winprops_collect(wp);
+	for (int i = 0; i < NUM_WINPROPS; i++) {
+		free(wp->prop[i].data);
+		wp->prop[i] = (struct winprop){0};
+	}
+}
+
+#else
+
+// Without XCB, requests are only noted, and everything is fetched in turn
+// on collection.
+
+void winprops_request(struct winprops *wp, unsigned what) {
+	wp->pending |= what;
+}
+
+void winprops_collect(struct winprops *wp) {
+	LOG_XENTER("winprops_collect(window=%lx)", (unsigned long)wp->w);
+	// The window may have gone away: each call below reports that by
+	// failing, so have the error handler ignore it.
+	xerror_ignore_begin(wp->w);
+	if (wp->pending & WINPROPS_ATTR) {
+		if (XGetWindowAttributes(display.dpy, wp->w, &wp->attr)) {
+			wp->valid |= WINPROPS_ATTR;
+			debug_window_attributes(&wp->attr);
+		}
+	}
+	if (wp->pending & WINPROPS_PROPS) {
+		for (int i = 0; i < NUM_WINPROPS; i++) {
+			struct winprop *p = &wp->prop[i];
+			unsigned long bytes_after;
+			unsigned char *data;
+			if (XGetWindowProperty(display.dpy, wp->w, winprop_atom(i),
+			                       0L, MAXIMUM_PROPERTY_LENGTH / 4, False,
+			                       AnyPropertyType, &p->type, &p->format,
+			                       &p->nitems, &bytes_after, &data) != Success) {
+				*p = (struct winprop){0};
+				continue;
+			}
+			if (p->type == None) {
+				XFree(data);
+				continue;
+			}
+			p->data = data;
+		}
+		wp->valid |= WINPROPS_PROPS;
+	}
+	if (wp->pending & WINPROPS_POINTER) {
+		wp->pointer_same_screen = get_pointer_root_xy(wp->w, &wp->pointer_x, &wp->pointer_y);
+		wp->valid |= WINPROPS_POINTER;
+	}
+	xerror_ignore_end();
+	wp->pending = 0;
+	LOG_XLEAVE();
+}
+
+void winprops_free(struct winprops *wp) {
+	for (int i = 0; i < NUM_WINPROPS; i++) {
+		if (wp->prop[i].data)
+			XFree(wp->prop[i].data);
+		wp->prop[i] = (struct winprop){0};
+	}
+}
+
+#endif
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+
+void *winprops_get(struct winprops *wp, int prop, Atom req_type,
+                   unsigned long *nitems_return) {
+	struct winprop *p = &wp->prop[prop];
+	if (!p->data || (req_type != AnyPropertyType && p->type != req_type))
+		return NULL;
+	if (nitems_return)
+		*nitems_return = p->nitems;
+	return p->data;
+}
+
+Bool winprops_get_pointer_root_xy(struct winprops *wp, int *x, int *y) {
+	if (!(wp->valid & WINPROPS_POINTER))
+		return get_pointer_root_xy(wp->w, x, y);
+	if (x)
+		*x = wp->pointer_x;
+	if (y)
+		*y = wp->pointer_y;
+	return wp->pointer_same_screen;
+}
+
+Bool winprops_get_wm_normal_hints(struct winprops *wp, XSizeHints *hints) {
+	struct winprop *p = &wp->prop[WINPROP_WM_NORMAL_HINTS];
+	if (!p->data || p->type != XA_WM_SIZE_HINTS || p->format != 32
+	    || p->nitems < OLD_NUM_PROP_SIZE_ELEMENTS)
+		return False;
+	long *prop = p->data;
+	long supplied = USPosition | USSize | PAllHints;
+	hints->flags = prop[0];
+	hints->x = prop[1];
+	hints->y = prop[2];
+	hints->width = prop[3];
+	hints->height = prop[4];
+	hints->min_width = prop[5];
+	hints->min_height = prop[6];
+	hints->max_width = prop[7];
+	hints->max_height = prop[8];
+	hints->width_inc = prop[9];
+	hints->height_inc = prop[10];
+	hints->min_aspect.x = prop[11];
+	hints->min_aspect.y = prop[12];
+	hints->max_aspect.x = prop[13];
+	hints->max_aspect.y = prop[14];
+	if (p->nitems >= NUM_PROP_SIZE_ELEMENTS) {
+		supplied |= PBaseSize | PWinGravity;
+		hints->base_width = prop[15];
+		hints->base_height = prop[16];
+		hints->win_gravity = prop[17];
+	}
+	hints->flags &= supplied;
+	return True;
+}
+
+void winprops_get_class_hint(struct winprops *wp, const char **res_name,
+                             const char **res_class) {
+	struct winprop *p = &wp->prop[WINPROP_WM_CLASS];
+	*res_name = *res_class = NULL;
+	if (!p->data || p->type != XA_STRING || p->format != 8)
+		return;
+	// Data is NUL-terminated, so if there's no separator, class is empty
+	const char *data = p->data;
+	size_t len_name = strlen(data);
+	*res_name = data;
+	*res_class = (len_name < p->nitems) ? data + len_name + 1 : data + p->nitems;
+}
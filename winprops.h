@@ -0,0 +1,104 @@
+/* evilwm - minimalist window manager for X11
+ * Copyright (C) 1999-2022 Ciaran Anscomb <evilwm@6809.org.uk>
+ * see README for license and other details. */
+
+// Window property prefetch.
+//
+// Adopting a window means reading its attributes and a handful of
+// properties.  Rather than wait on each in turn, requests are issued with
+// winprops_request() and the replies gathered later with winprops_collect().
+// Built with XCB, requests for any number of windows may be in flight at
+// once.  Otherwise, everything is fetched synchronously through Xlib at
+// collection time.
+
+#ifndef EVILWM_WINPROPS_H_
+#define EVILWM_WINPROPS_H_
+
+#include <stdint.h>
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#ifdef XCB
+#include <xcb/xcb.h>
+#endif
+
+// Properties fetched by WINPROPS_PROPS
+enum {
+	WINPROP_WM_NAME,
+	WINPROP_WM_CLASS,
+	WINPROP_WM_NORMAL_HINTS,
+	WINPROP_MOTIF_WM_HINTS,
+	WINPROP_NET_WM_WINDOW_TYPE,
+	WINPROP_NET_WM_DESKTOP,
+	WINPROP_NET_WM_PID,
+	WINPROP_EVILWM_UNMAXIMISED_HORZ,
+	WINPROP_EVILWM_UNMAXIMISED_VERT,
+	NUM_WINPROPS
+};
+
+// What to fetch
+#define WINPROPS_ATTR    (1<<0)  // window attributes and geometry
+#define WINPROPS_PROPS   (1<<1)  // all the properties listed above
+#define WINPROPS_POINTER (1<<2)  // pointer position
+
+// Property data is laid out as XGetWindowProperty() would return it (so
+// format 32 data is an array of long), with a terminating NUL.
+struct winprop {
+	Atom type;  // None if property not present
+	int format;
+	unsigned long nitems;
+	void *data;
+};
+
+struct winprops {
+	Window w;
+	unsigned pending;  // WINPROPS_* requested but not yet collected
+	unsigned valid;    // WINPROPS_* successfully collected
+
+	// Only attributes available from both Xlib and XCB are filled in:
+	// geometry, root, map_state, override_redirect and colormap.
+	XWindowAttributes attr;
+
+	struct winprop prop[NUM_WINPROPS];
+
+	// Pointer position in root coordinates, and whether it's on the same
+	// screen as the window
+	int pointer_x, pointer_y;
+	Bool pointer_same_screen;
+
+#ifdef XCB
+	xcb_get_window_attributes_cookie_t attr_cookie;
+	xcb_get_geometry_cookie_t geom_cookie;
+	xcb_get_property_cookie_t prop_cookie[NUM_WINPROPS];
+	xcb_query_pointer_cookie_t pointer_cookie;
+#endif
+#ifdef TRACE
+	uint64_t trace_time;  // when winprops_init() was called
+#endif
+};
+
+void winprops_init(struct winprops *wp, Window w);
+void winprops_request(struct winprops *wp, unsigned what);
+void winprops_collect(struct winprops *wp);
+void winprops_free(struct winprops *wp);
+
+// Returns property data if present and of the required type (or any type if
+// req_type is AnyPropertyType).  Data remains owned by wp.
+void *winprops_get(struct winprops *wp, int prop, Atom req_type,
+                   unsigned long *nitems_return);
+
+// Interpret WM_NORMAL_HINTS as XGetWMNormalHints() would.  Returns False if
+// not present, leaving hints untouched.
+Bool winprops_get_wm_normal_hints(struct winprops *wp, XSizeHints *hints);
+
+// As get_pointer_root_xy() on the window, using the prefetched position if
+// available.
+Bool winprops_get_pointer_root_xy(struct winprops *wp, int *x, int *y);
+
+// Interpret WM_CLASS as XGetClassHint() would.  Strings remain owned by wp,
+// and are NULL if the property is not present.
+void winprops_get_class_hint(struct winprops *wp, const char **res_name,
+                             const char **res_class);
+
+#endif